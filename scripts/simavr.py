@@ -0,0 +1,10 @@
+# Adds "pio run -e avrbench -t simavr": build the benchmark and run it under simavr
+Import("env")
+
+env.AddCustomTarget(
+    name="simavr",
+    dependencies="$BUILD_DIR/${PROGNAME}.elf",
+    actions="run_avr -m atmega32u4 -f $BOARD_F_CPU $BUILD_DIR/${PROGNAME}.elf",
+    title="simavr",
+    description="Run the AVR benchmark under simavr",
+)
@@ -0,0 +1,298 @@
+#include "Animation.h"
+#include "Effects.h"
+#include "AudioReactive.h"
+#include "NoiseEffects.h"
+#include "Sync.h"
+#include "Modulation.h"
+#include "Ignition.h"
+
+Mode current_mode{Mode::Static};
+Mode previous_mode{Mode::Static};
+uint32_t animation_start{0};
+static uint32_t paused_at;
+static bool static_color_shown; // Mode::Static is showing red, green, blue
+
+static uint32_t effect_time; // AnimationElapsed()
+static uint32_t effect_last; // AnimationTime() it was last brought up to
+static uint8_t effect_frac;  // 1/MOD_SPEED_NORMAL ms left over from the last advance
+
+// built at compile time and kept in flash, read with pgm_read_dword()
+const uint32_t color_wipe_colors[] PROGMEM = {OutputDriver::Color(114, 0, 255),
+                                              OutputDriver::Color(0, 0, 0),
+                                              OutputDriver::Color(0, 50, 255),
+                                              OutputDriver::Color(0, 0, 0),
+                                              OutputDriver::Color(0, 220, 255),
+                                              OutputDriver::Color(0, 0, 0),
+                                              OutputDriver::Color(255, 225, 255),
+                                              OutputDriver::Color(0, 0, 0)};
+constexpr uint8_t num_color_wipe_colors{sizeof(color_wipe_colors) / sizeof(color_wipe_colors[0])};
+
+static Task animation_task;
+static ColorWipeState color_wipe;
+
+uint32_t AnimationElapsed()
+{
+  uint32_t now = AnimationTime();
+  int32_t dt = (int32_t)(now - effect_last);
+  effect_last = now;
+  uint8_t speed = mod_params[(uint8_t)ModTarget::Speed];
+  if (speed == MOD_SPEED_NORMAL)
+  {
+    effect_time += dt; // exact, also when a sync correction steps the clock back
+  }
+  else if (dt > 0)
+  {
+    uint32_t scaled = (uint32_t)dt * speed + effect_frac;
+    effect_time += scaled / MOD_SPEED_NORMAL;
+    effect_frac = scaled % MOD_SPEED_NORMAL;
+  }
+  return effect_time;
+}
+
+uint32_t EffectToRealMs(uint32_t ms)
+{
+  uint8_t speed = mod_params[(uint8_t)ModTarget::Speed];
+  if (speed == MOD_SPEED_NORMAL)
+  {
+    return ms;
+  }
+  if (speed == 0)
+  {
+    return MOD_FRAME_MS; // stopped, look again once the speed may have changed
+  }
+  return ((uint32_t)ms * MOD_SPEED_NORMAL + speed - 1) / speed;
+}
+
+void StartMode(Mode mode)
+{
+  StartModeAt(mode, AnimationTime());
+}
+
+void StartModeAt(Mode mode, uint32_t start)
+{
+  if (current_mode == Mode::AudioReactive && mode != Mode::AudioReactive)
+  {
+    StopAudioReactive();
+  }
+  bool blade_moving = current_mode == Mode::Ignition || current_mode == Mode::Retraction;
+  current_mode = mode;
+  animation_start = start;
+  effect_time = 0;
+  effect_last = start;
+  effect_frac = 0;
+  static_color_shown = false;
+  switch (mode)
+  {
+  case Mode::ColorWipes:
+  case Mode::RotateColorWipes:
+    color_wipe = ColorWipeState{color_wipe_colors, num_color_wipe_colors, 30, mode == Mode::RotateColorWipes, 0};
+    TaskStart(animation_task, ColorWipeTask, &color_wipe);
+    break;
+  case Mode::AudioReactive:
+    StartAudioReactive();
+    TaskStart(animation_task, AudioReactiveTask, nullptr);
+    break;
+  case Mode::Fire:
+    StartNoiseEffect();
+    TaskStart(animation_task, FireTask, nullptr);
+    break;
+  case Mode::Plasma:
+    StartNoiseEffect();
+    TaskStart(animation_task, PlasmaTask, nullptr);
+    break;
+  case Mode::Flicker:
+    StartNoiseEffect();
+    TaskStart(animation_task, FlickerTask, nullptr);
+    break;
+  case Mode::Ignition:
+  case Mode::Retraction:
+    StartBladeMotion(mode == Mode::Ignition, blade_moving);
+    TaskStart(animation_task, IgnitionTask, nullptr);
+    break;
+  default:
+    previous_mode = Mode::Static; // nothing to resume after an explicit switch to static
+    TaskSuspend(animation_task);
+    break;
+  }
+}
+
+void PauseAnimation()
+{
+  if (current_mode != Mode::Static)
+  {
+    previous_mode = current_mode;
+    current_mode = Mode::Static;
+    paused_at = AnimationTime();
+    AnimationElapsed(); // bring the effect clock up to the pause
+    TaskSuspend(animation_task);
+  }
+}
+
+void ResumeAnimation()
+{
+  if (current_mode == Mode::Static && previous_mode != Mode::Static)
+  {
+    current_mode = previous_mode;
+    // carry on from the frame we paused at
+    uint32_t now = AnimationTime();
+    animation_start += now - paused_at;
+    effect_last = now;
+    TaskResume(animation_task);
+  }
+}
+
+uint32_t PausedElapsed()
+{
+  return paused_at - animation_start;
+}
+
+// The animation on the blade, running or paused
+static Mode ShownMode()
+{
+  return current_mode == Mode::Static ? previous_mode : current_mode;
+}
+
+// Whatever this sword showed before would linger where a new mode does not draw
+static void ClearForMode(Mode mode)
+{
+  if (ShownMode() != mode)
+  {
+    for (uint16_t i = 0; i < NUMPIXELS; i++)
+    {
+      pixel.setPixelColor(i, 0);
+    }
+  }
+}
+
+// Redraw a paused animation at AnimationElapsed(); fire and audio are
+// different on every sword anyway and keep the frame they have
+static void DrawPausedFrame(Mode mode)
+{
+  switch (mode)
+  {
+  case Mode::ColorWipes:
+  case Mode::RotateColorWipes:
+    ColorWipeFrame(color_wipe);
+    break;
+  case Mode::Plasma:
+    RenderPlasma(AnimationElapsed() >> 3);
+    break;
+  case Mode::Flicker:
+    RenderFlicker(AnimationElapsed() >> 2);
+    break;
+  default:
+    break;
+  }
+  pixel.show();
+}
+
+static bool FollowingMaster(Mode mode)
+{
+  // a blade in motion finishes first, the next sync packet catches up
+  return mode <= Mode::Flicker && current_mode != Mode::Ignition && current_mode != Mode::Retraction;
+}
+
+void SyncAnimation(Mode mode, uint32_t start)
+{
+  if (!FollowingMaster(mode))
+  {
+    return;
+  }
+  if (mode != current_mode || start != animation_start)
+  {
+    ClearForMode(mode);
+    StartModeAt(mode, start);
+  }
+}
+
+void SyncPausedAnimation(Mode mode, uint32_t elapsed)
+{
+  if (!FollowingMaster(mode) || mode == Mode::Static)
+  {
+    return;
+  }
+  if (current_mode == Mode::Static && previous_mode == mode && PausedElapsed() == elapsed)
+  {
+    return;
+  }
+  ClearForMode(mode);
+  uint32_t now = AnimationTime();
+  if (current_mode != mode)
+  {
+    StartModeAt(mode, now - elapsed);
+  }
+  PauseAnimation();
+  // frozen at the master's frame, and resuming from it like the master does
+  paused_at = now;
+  animation_start = now - elapsed;
+  effect_time = elapsed;
+  effect_last = now;
+  effect_frac = 0;
+  DrawPausedFrame(mode);
+}
+
+void SyncStaticColor(bool lit, uint8_t r, uint8_t g, uint8_t b)
+{
+  if (!FollowingMaster(Mode::Static))
+  {
+    return;
+  }
+  if (lit)
+  {
+    if (!(current_mode == Mode::Static && static_color_shown && red == r && green == g && blue == b))
+    {
+      ShowStaticColor(r, g, b);
+    }
+  }
+  else if (!BladeDark())
+  {
+    StartMode(Mode::Static);
+    for (uint16_t i = 0; i < NUMPIXELS; i++)
+    {
+      pixel.setPixelColor(i, 0);
+    }
+    pixel.show();
+  }
+}
+
+static void FillStaticColor()
+{
+  for (uint16_t i = 0; i < NUMPIXELS; i++)
+  {
+    pixel.setPixelColor(i, pixel.Color(red, green, blue));
+  }
+}
+
+void ShowStaticColor(uint8_t r, uint8_t g, uint8_t b)
+{
+  StartMode(Mode::Static);
+  red = r;
+  green = g;
+  blue = b;
+  FillStaticColor();
+  pixel.show();
+  static_color_shown = true;
+}
+
+bool BladeDark()
+{
+  return current_mode == Mode::Static && previous_mode == Mode::Static && !static_color_shown;
+}
+
+bool SetBladeBrightness(uint8_t level)
+{
+  if (current_mode == Mode::Static && static_color_shown)
+  {
+    pixel.setBrightness(level);
+    FillStaticColor();
+    pixel.show();
+    return true;
+  }
+  if (TaskRunning(animation_task))
+  {
+    // every animation task redraws its whole frame before the next show()
+    pixel.setBrightness(level);
+    return true;
+  }
+  return false;
+}
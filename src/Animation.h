@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Platform.h"
+
+enum class Mode
+{
+  Static,
+  ColorWipes,
+  RotateColorWipes,
+  LarsonScanners,
+  AudioReactive,
+  Fire,
+  Plasma,
+  Flicker,
+  Ignition,  // per sword, not followed by sync receivers (see Ignition.h)
+  Retraction //,
+             // EtCetera
+};
+
+extern Mode current_mode;
+extern Mode previous_mode;
+
+// Switch to mode and (re)start its animation task from the beginning.
+// The task itself runs from SchedulerRun().
+void StartMode(Mode mode);
+// Same, but as if the animation had started at AnimationTime() start
+void StartModeAt(Mode mode, uint32_t start);
+
+// AnimationTime() at which the current animation started, pauses excluded
+extern uint32_t animation_start;
+// ms the current animation has been running, what time based effects render from.
+// Runs at the modulated speed (ModTarget::Speed), so it is only equal to
+// AnimationTime() - animation_start while that stays at MOD_SPEED_NORMAL.
+uint32_t AnimationElapsed();
+// Real ms until AnimationElapsed() has moved on by ms, for task delays
+uint32_t EffectToRealMs(uint32_t ms);
+
+// Mode::Static showing one color on the whole blade (the Controller's color picker)
+void ShowStaticColor(uint8_t r, uint8_t g, uint8_t b);
+
+// Nothing on the blade: Mode::Static with no color picked and nothing paused
+bool BladeDark();
+
+// Change the blade brightness, redrawing what is on it.  Without DITHER
+// Adafruit_NeoPixel rescales its pixel buffer in setBrightness(), losing
+// precision, so this is refused (false) when nothing will redraw the
+// frame: while paused, or in a mode without an animation task and no
+// color picked.
+bool SetBladeBrightness(uint8_t level);
+
+// Follow the sync master (see Sync.h): run mode as started at master time
+// start, hold mode paused elapsed ms into it, or show the master's static
+// blade, lit in r, g, b or dark
+void SyncAnimation(Mode mode, uint32_t start);
+void SyncPausedAnimation(Mode mode, uint32_t elapsed);
+void SyncStaticColor(bool lit, uint8_t r, uint8_t g, uint8_t b);
+
+// Freeze the current animation where it is / carry on from there
+void PauseAnimation();
+void ResumeAnimation();
+// ms into the animation it was frozen at, while paused
+uint32_t PausedElapsed();
@@ -0,0 +1,337 @@
+#include "AudioReactive.h"
+#include "Effects.h"
+#include "Modulation.h"
+
+static_assert(AUDIO_FFT_LOG2 >= 4 && AUDIO_FFT_LOG2 <= 6, "the twiddle and window tables cover 16 to 64 points");
+
+// sin(2*pi*k/64) in Q15 for k = 0..47, cos(2*pi*k/64) is entry k + 16
+static const int16_t sine64[48] PROGMEM = {
+    0, 3212, 6393, 9512, 12539, 15446, 18204, 20787, 23170, 25329, 27245, 28898,
+    30273, 31356, 32137, 32609, 32767, 32609, 32137, 31356, 30273, 28898, 27245, 25329,
+    23170, 20787, 18204, 15446, 12539, 9512, 6393, 3212, 0, -3212, -6393, -9512,
+    -12539, -15446, -18204, -20787, -23170, -25329, -27245, -28898, -30273, -31356, -32137, -32609};
+
+// first half of a 64 point Hann window in Q15, the second half is its mirror image
+static const int16_t hann64[33] PROGMEM = {
+    0, 79, 315, 705, 1247, 1935, 2761, 3719, 4799, 5990, 7281, 8660,
+    10114, 11628, 13187, 14778, 16383, 17989, 19580, 21139, 22653, 24107, 25486, 26777,
+    27968, 29048, 30006, 30832, 31520, 32062, 32452, 32688, 32767};
+
+// written by the ADC interrupt, read by LoadSamples()
+static volatile uint16_t ring[AUDIO_FFT_SIZE];
+static volatile uint8_t ring_head{0};
+static volatile uint8_t ring_fresh{0}; // samples pushed since the last LoadSamples()
+static uint8_t fresh_needed;              // how many of them the next LoadSamples() waits for
+
+static int16_t re[AUDIO_FFT_SIZE];
+static int16_t im[AUDIO_FFT_SIZE];
+
+uint16_t audio_bands[AUDIO_BANDS];
+
+// Pipeline slices: load, one per butterfly stage, band sums, then idle
+static const uint8_t kLoad = 0;
+static const uint8_t kBands = AUDIO_FFT_LOG2 + 1;
+static const uint8_t kIdle = AUDIO_FFT_LOG2 + 2;
+static uint8_t fft_step{kIdle};
+
+static uint32_t last_audio_frame;
+static uint16_t level_peak;  // decaying peak of the total energy, used as automatic gain
+static uint8_t shown_level;  // level currently on the blade, falls back slowly
+
+void AudioPushSample(uint16_t sample)
+{
+  uint8_t head = ring_head;
+  ring[head] = sample;
+  ring_head = (head + 1) & (AUDIO_FFT_SIZE - 1);
+  if (ring_fresh < 255)
+  {
+    ring_fresh++;
+  }
+}
+
+#ifdef __AVR__
+#if AUDIO_ADC_PRESCALER == 128
+static const uint8_t kAdcPrescaler = _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+#else
+static const uint8_t kAdcPrescaler = _BV(ADPS2) | _BV(ADPS1);
+#endif
+
+// Free running at 8MHz / 64 / 13 (or 16MHz / 128 / 13) = 9615 conversions/s,
+// every other one is kept
+ISR(ADC_vect)
+{
+  static bool keep;
+  uint16_t sample = ADC;
+  keep = !keep;
+  if (keep)
+  {
+    AudioPushSample(sample);
+  }
+}
+
+static void StartSampling()
+{
+  analogRead(AUDIO_PIN); // let the core select the channel, including MUX5
+  ADCSRB &= ~0x0F;       // ADTS = 0: free running
+  ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIE) | kAdcPrescaler;
+}
+
+static void StopSampling()
+{
+  // back to the single conversion setup analogRead() expects
+  ADCSRA = _BV(ADEN) | kAdcPrescaler;
+}
+
+// Sending a strip keeps interrupts off for about 1.6 ms, so the ISR misses
+// several conversions and the samples either side of a show() are not
+// evenly spaced.  True once per show(), after which the next window waits
+// for a full AUDIO_FFT_SIZE samples taken since.
+static uint32_t frames_seen;
+
+static bool ShownSinceLastCheck()
+{
+  uint32_t shown = pixel.framesShown();
+  bool gap = shown != frames_seen;
+  frames_seen = shown;
+  return gap;
+}
+#else
+static void StartSampling() {}
+static void StopSampling() {}
+
+// samples pushed by the caller have no gaps
+static bool ShownSinceLastCheck() { return false; }
+#endif
+
+static uint8_t BitReverse(uint8_t i)
+{
+  uint8_t r = 0;
+  for (uint8_t b = 0; b < AUDIO_FFT_LOG2; b++)
+  {
+    r = (r << 1) | (i & 1);
+    i >>= 1;
+  }
+  return r;
+}
+
+static int16_t Window(uint8_t i)
+{
+  uint8_t idx = i << (6 - AUDIO_FFT_LOG2);
+  if (idx > 32)
+  {
+    idx = 64 - idx;
+  }
+  return pgm_read_word(&hann64[idx]);
+}
+
+// Copy the newest AUDIO_FFT_SIZE samples, remove DC, window and store them bit reversed
+static void LoadSamples()
+{
+  uint16_t samples[AUDIO_FFT_SIZE];
+  noInterrupts();
+  uint8_t head = ring_head;
+  for (uint8_t i = 0; i < AUDIO_FFT_SIZE; i++)
+  {
+    samples[i] = ring[(head + i) & (AUDIO_FFT_SIZE - 1)];
+  }
+  ring_fresh = 0;
+  interrupts();
+  fresh_needed = AUDIO_FFT_SIZE / 2;
+
+  uint16_t sum = 0;
+  for (uint8_t i = 0; i < AUDIO_FFT_SIZE; i++)
+  {
+    sum += samples[i];
+  }
+  int16_t mean = sum >> AUDIO_FFT_LOG2;
+
+  for (uint8_t i = 0; i < AUDIO_FFT_SIZE; i++)
+  {
+    int16_t x = (int16_t)(samples[i] - mean) * 32; // +-1023 -> about +-32k
+    uint8_t j = BitReverse(i);
+    re[j] = ((int32_t)x * Window(i)) >> 15;
+    im[j] = 0;
+  }
+}
+
+// One radix-2 decimation in time stage, scaled by 1/2 so it cannot overflow
+static void ButterflyStage(uint8_t stage)
+{
+  uint8_t half = 1 << stage;
+  for (uint8_t k = 0; k < half; k++)
+  {
+    uint8_t t = k << (5 - stage); // W_N^k as an index into the 64 point table
+    int32_t wr = (int16_t)pgm_read_word(&sine64[t + 16]);
+    int32_t wi = (int16_t)pgm_read_word(&sine64[t]);
+    for (uint8_t i = k; i < AUDIO_FFT_SIZE; i += 2 * half)
+    {
+      uint8_t j = i + half;
+      int32_t tr = (wr * re[j] + wi * im[j]) >> 15;
+      int32_t ti = (wr * im[j] - wi * re[j]) >> 15;
+      re[j] = (re[i] - tr) >> 1;
+      im[j] = (im[i] - ti) >> 1;
+      re[i] = (re[i] + tr) >> 1;
+      im[i] = (im[i] + ti) >> 1;
+    }
+  }
+}
+
+// Average magnitude per band, |z| approximated as max + min / 2
+static void SumBands()
+{
+  for (uint8_t b = 0; b < AUDIO_BANDS; b++)
+  {
+    uint32_t sum = 0;
+    for (uint8_t bin = 1 << b; bin < (2 << b); bin++)
+    {
+      uint16_t a = re[bin] < 0 ? -re[bin] : re[bin];
+      uint16_t c = im[bin] < 0 ? -im[bin] : im[bin];
+      sum += a > c ? a + (c >> 1) : c + (a >> 1);
+    }
+    sum >>= b;
+    audio_bands[b] = sum > 0xffff ? 0xffff : sum;
+  }
+}
+
+static void RenderAudioFrame()
+{
+  uint32_t total = 0;
+  uint32_t weighted = 0;
+  for (uint8_t b = 0; b < AUDIO_BANDS; b++)
+  {
+    total += audio_bands[b];
+    weighted += (uint32_t)audio_bands[b] * b;
+  }
+
+  // automatic gain: follow the loudest recent frame, never amplify the noise floor
+  if (total > level_peak)
+  {
+    level_peak = total > 0xffff ? 0xffff : total;
+  }
+  else
+  {
+    level_peak -= level_peak >> 5;
+  }
+  if (level_peak < 64)
+  {
+    level_peak = 64;
+  }
+  uint8_t level = total >= level_peak ? 255 : total * 255 / level_peak;
+
+  // jump up, fall back over a few frames
+  if (level >= shown_level)
+  {
+    shown_level = level;
+  }
+  else
+  {
+    shown_level -= (shown_level >> 3) + 1;
+  }
+
+  // bass is red, through green, to treble in blue
+  uint8_t hue = total ? weighted * 170 / (total * (AUDIO_BANDS - 1)) : 0;
+  uint32_t c = Wheel(hue + mod_params[(uint8_t)ModTarget::Hue]);
+  uint16_t scale = (uint16_t)shown_level + 1;
+  uint32_t scaled = pixel.Color((((c >> 16) & 0xff) * scale) >> 8,
+                                (((c >> 8) & 0xff) * scale) >> 8,
+                                ((c & 0xff) * scale) >> 8);
+
+  uint16_t lit = shown_level ? (((uint16_t)shown_level * NUMPIXELS) >> 8) + 1 : 0;
+  for (uint16_t i = 0; i < NUMPIXELS; i++)
+  {
+    pixel.setPixelColor(i, i < lit ? scaled : 0);
+  }
+  pixel.show();
+}
+
+void StartAudioReactive()
+{
+  noInterrupts();
+  ring_head = 0;
+  ring_fresh = 0;
+  for (uint8_t i = 0; i < AUDIO_FFT_SIZE; i++)
+  {
+    ring[i] = 512;
+  }
+  interrupts();
+  for (uint8_t b = 0; b < AUDIO_BANDS; b++)
+  {
+    audio_bands[b] = 0;
+  }
+  fft_step = kIdle;
+  fresh_needed = AUDIO_FFT_SIZE / 2;
+  ShownSinceLastCheck();
+  level_peak = 0;
+  shown_level = 0;
+  last_audio_frame = millis();
+  StartSampling();
+}
+
+void StopAudioReactive()
+{
+  StopSampling();
+}
+
+// Runs one slice, returns false when it is waiting for samples
+static bool ProcessAudioReactive()
+{
+  if (ShownSinceLastCheck())
+  {
+    ring_fresh = 0;
+    fresh_needed = AUDIO_FFT_SIZE;
+    if (fft_step == kLoad)
+    {
+      fft_step = kIdle;
+    }
+  }
+
+  if (fft_step == kIdle)
+  {
+    // 50% overlap between consecutive FFTs
+    if (ring_fresh >= fresh_needed)
+    {
+      fft_step = kLoad;
+    }
+  }
+  else
+  {
+    if (fft_step == kLoad)
+    {
+      LoadSamples();
+    }
+    else if (fft_step < kBands)
+    {
+      ButterflyStage(fft_step - 1);
+    }
+    else
+    {
+      SumBands();
+    }
+    fft_step++;
+  }
+
+  if (millis() - last_audio_frame >= AUDIO_FRAME_MS)
+  {
+    last_audio_frame += AUDIO_FRAME_MS;
+    RenderAudioFrame();
+  }
+  return fft_step != kIdle;
+}
+
+void AudioReactiveTask(Task &task)
+{
+  TASK_BEGIN(task);
+  for (;;)
+  {
+    if (ProcessAudioReactive())
+    {
+      TASK_YIELD(task);
+    }
+    else
+    {
+      // half an FFT of new samples takes over 3 ms to come in, let the CPU sleep
+      TASK_SLEEP(task, 1);
+    }
+  }
+  TASK_END(task);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Platform.h"
+#include "BladeConfig.h"
+#include "Scheduler.h"
+
+/*=========================================================================
+    AUDIO REACTIVE
+
+    Samples a microphone into a small ring buffer, runs a fixed-point FFT
+    over the latest AUDIO_FFT_SIZE samples and maps the band energies onto
+    the blade through Wheel(): loudness sets how far up the blade it lights
+    and how bright, the spectral balance sets the hue.
+
+    The FFT is split into slices (load, one butterfly stage, band sums) and
+    AudioReactiveTask runs at most one slice before it yields, so it never
+    holds up the other tasks for more than a few hundred microseconds.
+
+    On AVR the ADC runs free and its interrupt feeds AudioPushSample().
+    A show() keeps interrupts off long enough to lose conversions, so no
+    FFT window spans one.  Anywhere else samples are pushed by the
+    caller, e.g. from a PCM file.
+    -----------------------------------------------------------------------*/
+#define AUDIO_FFT_SIZE (1 << AUDIO_FFT_LOG2)
+#define AUDIO_BANDS (AUDIO_FFT_LOG2 - 1)
+
+// Start sampling and reset the pipeline
+void StartAudioReactive();
+// Stop sampling (leaves the blade as it is)
+void StopAudioReactive();
+// Scheduler task: one pipeline slice per run, plus a frame every AUDIO_FRAME_MS
+void AudioReactiveTask(Task &task);
+
+// Add one 10-bit ADC reading (0..1023) to the ring buffer; safe to call from an ISR
+void AudioPushSample(uint16_t sample);
+
+// Latest energy per band, band b covering FFT bins [2^b, 2^(b+1))
+extern uint16_t audio_bands[AUDIO_BANDS];
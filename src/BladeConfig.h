@@ -0,0 +1,66 @@
+// BLADE SETTINGS
+// ----------------------------------------------------------------------------------------------
+// PIN                       Which pin on the Arduino is connected to the NeoPixels?
+// PIN2                      Which pin is connected to the second NeoPixel strip?
+// NUMPIXELS                 How many NeoPixels are attached to each pin?
+// NEOPIXEL_TYPE             Color order and data rate of the NeoPixels
+//
+// Timer3 belongs to IdleSleep() (see PowerSave.h), which stops it after every sleep: pin 5
+// (OC3A) cannot be used for analogWrite(), nor tone(), which also runs on Timer3 on the 32u4.
+// ----------------------------------------------------------------------------------------------
+#define PIN 6
+#define PIN2 9
+#define NUMPIXELS 53
+#define NEOPIXEL_TYPE (NEO_GRB + NEO_KHZ800)
+
+// AUDIO SETTINGS
+// ----------------------------------------------------------------------------------------------
+// AUDIO_PIN                 Analog pin the microphone amplifier output is connected to
+// AUDIO_FFT_LOG2            log2 of the FFT size: 5 (32 points) or 6 (64 points)
+// AUDIO_CPU_HZ              CPU clock the ADC timing is worked out from (F_CPU, or the 8 MHz
+//                           of the feather32u4 where there is none)
+// AUDIO_ADC_PRESCALER       ADC clock divider, 125 kHz of ADC clock at 8 or 16 MHz; the same one
+//                           the Arduino core sets up for analogRead()
+// AUDIO_SAMPLE_RATE         Samples per second that reach the FFT: 13 ADC clocks per
+//                           conversion, every other conversion kept (4808 Hz)
+// AUDIO_FRAME_MS            Time between rendered frames in Mode::AudioReactive
+// ----------------------------------------------------------------------------------------------
+#define AUDIO_PIN A1
+#define AUDIO_FFT_LOG2 5
+#ifdef F_CPU
+#define AUDIO_CPU_HZ F_CPU
+#else
+#define AUDIO_CPU_HZ 8000000UL
+#endif
+#if AUDIO_CPU_HZ > 8000000UL
+#define AUDIO_ADC_PRESCALER 128
+#else
+#define AUDIO_ADC_PRESCALER 64
+#endif
+#define AUDIO_SAMPLE_RATE ((AUDIO_CPU_HZ / AUDIO_ADC_PRESCALER + 13) / 26)
+#define AUDIO_FRAME_MS 20
+
+// NOISE EFFECT SETTINGS
+// ----------------------------------------------------------------------------------------------
+// NOISE_FRAME_MS            Time between frames of Mode::Fire, Mode::Plasma and Mode::Flicker
+// FIRE_COOLING              How much the fire cools down every frame (20 - 100)
+// FIRE_SPARKING             Chance out of 255 of a new spark near the hilt every frame
+// ----------------------------------------------------------------------------------------------
+#define NOISE_FRAME_MS 16
+#define FIRE_COOLING 55
+#define FIRE_SPARKING 120
+
+// OUTPUT SETTINGS
+// ----------------------------------------------------------------------------------------------
+// DITHER                    1: apply the brightness when sending and carry the fraction of a
+//                           level it drops over to the next frames (temporal dithering),
+//                           0: let Adafruit_NeoPixel scale the pixel buffer as it is written.
+//                           Off until avrbench's "max dithered rate" is known: a fraction 1/k
+//                           of a level pulses at 1000 / (k * DITHER_FRAME_MS) Hz, which is
+//                           visible (7.8 Hz for 1/8 at 16 ms), and it costs 477 B of RAM
+// DITHER_FRAME_MS           Time between refreshes of a blade that sits between two levels;
+//                           each one keeps interrupts off for the 1.6 ms one strip takes,
+//                           twice, so millis() runs up to 1.6 ms late but does not drift
+// ----------------------------------------------------------------------------------------------
+#define DITHER 0
+#define DITHER_FRAME_MS 16
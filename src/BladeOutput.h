@@ -0,0 +1,21 @@
+#pragma once
+
+#include "BladeConfig.h"
+
+/*=========================================================================
+    BLADE OUTPUT
+
+    The OutputDriver this program is built with, as a concrete type, so
+    every call on `pixel` is direct and can be inlined: DualNeopixel on
+    the sword, FrameSinkOutput on a Linux host.
+    -----------------------------------------------------------------------*/
+#ifdef ARDUINO
+#include "DualNeopixel.h"
+typedef DualNeopixel<NUMPIXELS, PIN, PIN2, NEOPIXEL_TYPE> BladeOutput;
+#else
+#include "host/FrameSinkOutput.h"
+typedef FrameSinkOutput BladeOutput;
+#endif
+
+// the blade, defined by the program's main file
+extern BladeOutput pixel;
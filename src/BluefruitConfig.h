@@ -4,7 +4,9 @@
 // ----------------------------------------------------------------------------------------------
 #define BUFSIZE 128               // Size of the read buffer for incoming data
 #define VERBOSE_MODE true         // If set to 'true' enables debug output
-#define BLE_READPACKET_TIMEOUT 10 // Timeout in ms waiting to read a response
+#define BLE_READPACKET_TIMEOUT 10 // Timeout in ms waiting for the rest of a partial packet
+#define BLE_POLL_INTERVAL 5       // Time in ms between checks for incoming data
+#define BLE_IDLE_POLL_INTERVAL 50 // The same while the blade is static
 
 // SOFTWARE UART SETTINGS
 // ----------------------------------------------------------------------------------------------
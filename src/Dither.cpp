@@ -0,0 +1,42 @@
+#include "Dither.h"
+#include "BladeOutput.h"
+#include "Scheduler.h"
+
+static Task dither_task;
+static bool refreshing; // the task's own show() is running
+
+bool DitherScale(uint8_t *out, const uint8_t *in, uint8_t *residue, uint16_t count, uint16_t scale)
+{
+  uint8_t between = 0;
+  for (uint16_t i = 0; i < count; i++)
+  {
+    // 255 * 256 + 255 still fits
+    uint16_t v = (uint16_t)in[i] * scale;
+    between |= (uint8_t)v;
+    v += residue[i];
+    out[i] = v >> 8;
+    residue[i] = v;
+  }
+  return between != 0;
+}
+
+static void DitherTask(Task &task)
+{
+  TASK_BEGIN(task);
+  while (pixel.dithering())
+  {
+    refreshing = true;
+    pixel.show();
+    refreshing = false;
+    TASK_SLEEP(task, DITHER_FRAME_MS);
+  }
+  TASK_END(task);
+}
+
+void DitherWake()
+{
+  if (!refreshing && !TaskRunning(dither_task))
+  {
+    TaskStart(dither_task, DitherTask, nullptr, DITHER_FRAME_MS);
+  }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Platform.h"
+#include "BladeConfig.h"
+
+/*=========================================================================
+    TEMPORAL DITHER
+
+    At a low brightness 8-bit color times brightness leaves only a few
+    distinct levels per channel, and a slow fade walks down them in
+    visible steps.  With DITHER the drivers keep the colors at full scale
+    and apply the brightness when sending, as a 16-bit product: the LEDs
+    get the high byte and the low byte is added to the same channel in
+    the next frame (first order error diffusion over time).  Averaged
+    over a few frames every channel then shows its exact level.
+
+    That only averages out if frames keep coming while a channel sits
+    between two levels, even when no pixel changes, so the drivers wake
+    a task that show()s every DITHER_FRAME_MS until nothing is between
+    levels any more.  At full brightness nothing ever is, and the output
+    is the same as without dithering.
+    -----------------------------------------------------------------------*/
+
+// out[i] = in[i] * scale / 256 plus the fraction carried in residue[i],
+// scale 1..256 as Adafruit_NeoPixel's brightness + 1.  Returns true if a
+// channel fell between two output levels.
+bool DitherScale(uint8_t *out, const uint8_t *in, uint8_t *residue, uint16_t count, uint16_t scale);
+
+// Called by a driver whose show() left channels between levels: keep
+// showing until they are not
+void DitherWake();
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <string.h>
+#include <Adafruit_NeoPixel.h>
+#include "OutputDriver.h"
+#include "BladeConfig.h"
+#include "Dither.h"
+
+/*=========================================================================
+    STATIC NEOPIXEL STRIP
+
+    Adafruit_NeoPixel allocates its pixel buffer with malloc() whenever the
+    length is set.  StaticNeopixel keeps the buffer inside the object instead,
+    so a global strip lands in .bss and its RAM cost shows up at link time.
+    The pixel count, pin and color order are template parameters so the
+    compiler sees them as constants.
+    -----------------------------------------------------------------------*/
+
+// Bytes per pixel of a NeoPixel type: 4 when it has a white channel, that
+// is when its white and red offsets differ (see Adafruit_NeoPixel::updateType())
+constexpr uint8_t NeopixelBytes(neoPixelType type)
+{
+  return ((type >> 6) & 3) == ((type >> 4) & 3) ? 3 : 4;
+}
+
+template <uint16_t N, int16_t DataPin, neoPixelType Type>
+class StaticNeopixel : public Adafruit_NeoPixel
+{
+public:
+  static const uint16_t kBytes = N * NeopixelBytes(Type);
+
+  StaticNeopixel() : Adafruit_NeoPixel()
+  {
+    // updateType() must run while pixels is still NULL, otherwise it would
+    // try to reallocate the buffer
+    updateType(Type);
+    memset(buffer, 0, sizeof(buffer));
+    numLEDs = N;
+    numBytes = sizeof(buffer);
+    pixels = buffer;
+    setPin(DataPin);
+  }
+
+  // the base destructor free()s pixels, which we do not own
+  ~StaticNeopixel() { pixels = nullptr; }
+
+  // Send data instead of the pixel buffer, which stays as it is
+  void showFrom(uint8_t *data)
+  {
+    pixels = data;
+    show();
+    pixels = buffer;
+  }
+
+private:
+  uint8_t buffer[kBytes];
+};
+
+/*=========================================================================
+    DUAL NEOPIXEL
+
+    The NeoPixel OutputDriver: two identical strips (one per side of the
+    blade) driven as a single object.  setPixelColor(n, c) writes both
+    strips, setPixelColor(side, n, c) writes only one of them.
+
+    show() only sends the strips when a pixel or the brightness was set
+    since the last one.  Sending 2 x 53 pixels keeps interrupts off for
+    over 3 ms, which is wasted on a frame the blade already shows.
+
+    With DITHER the strips' own buffers hold the colors at full scale
+    (their brightness is never set) and show() scales each strip into
+    one shared output buffer with DitherScale().  The output buffer and
+    the residues cost 9 more bytes of RAM per RGB pixel, 477 for 53.
+    It then also sends while channels are between levels, and
+    setBrightness() no longer loses precision.  Each strip is sent with
+    interrupts off on its own, and as long as that is shorter than a
+    timer0 overflow the millis() tick is only late, never lost.
+    -----------------------------------------------------------------------*/
+template <uint16_t N, int16_t DataPin1, int16_t DataPin2, neoPixelType Type = NEO_GRB + NEO_KHZ800>
+class DualNeopixel : public OutputDriver
+{
+public:
+  void begin()
+  {
+    p1.begin();
+    p2.begin();
+    dirty = true;
+  }
+
+  void setPixelColor(uint16_t n, uint32_t c)
+  {
+    Set(p1, n, c);
+    Set(p2, n, c);
+  }
+
+  void setPixelColor(bool pixel, uint16_t n, uint32_t c)
+  {
+    if (pixel)
+    {
+      Set(p2, n, c);
+    }
+    else
+    {
+      Set(p1, n, c);
+    }
+  }
+
+  void show()
+  {
+#if DITHER
+    if (!dirty && !between)
+    {
+      shows_skipped++;
+      return;
+    }
+    between = Send(p1, residue[0]);
+    between = Send(p2, residue[1]) || between;
+    if (between)
+    {
+      DitherWake();
+    }
+#else
+    if (!dirty)
+    {
+      shows_skipped++;
+      return;
+    }
+    p1.show();
+    p2.show();
+#endif
+    dirty = false;
+    frames_shown++;
+  }
+
+  void setBrightness(uint8_t b)
+  {
+#if DITHER
+    scale = (uint16_t)b + 1;
+#else
+    p1.setBrightness(b);
+    p2.setBrightness(b);
+#endif
+    dirty = true;
+  }
+
+  uint16_t numPixels() const { return N; }
+
+#if DITHER
+  bool dithering() const { return between; }
+#else
+  bool dithering() const { return false; }
+#endif
+
+  uint32_t framesShown() const { return frames_shown; }
+
+  // show() calls that sent nothing because nothing had been set
+  uint32_t shows_skipped{0};
+
+private:
+  template <int16_t DataPin>
+  void Set(StaticNeopixel<N, DataPin, Type> &strip, uint16_t n, uint32_t c)
+  {
+    // no getPixelColor() to compare first: that would unpack (and with a
+    // brightness set, unscale) every pixel of every frame
+    strip.setPixelColor(n, c);
+    dirty = true;
+  }
+
+#if DITHER
+  template <int16_t DataPin>
+  bool Send(StaticNeopixel<N, DataPin, Type> &strip, uint8_t *strip_residue)
+  {
+    bool b = DitherScale(out, strip.getPixels(), strip_residue, kBytes, scale);
+    strip.showFrom(out);
+    return b;
+  }
+#endif
+
+  static const uint16_t kBytes = StaticNeopixel<N, DataPin1, Type>::kBytes;
+
+#if DITHER
+  // 10 us per byte at 800 kHz, against 64 x 256 CPU cycles per timer0 overflow
+  static_assert(kBytes * 10UL < clockCyclesToMicroseconds(64UL * 256),
+                "a strip takes longer than a timer0 overflow to send: with DITHER every refresh loses a millis() tick");
+#endif
+
+  StaticNeopixel<N, DataPin1, Type> p1;
+  StaticNeopixel<N, DataPin2, Type> p2;
+  bool dirty{true};
+  uint32_t frames_shown{0};
+#if DITHER
+  uint16_t scale{256};       // brightness + 1
+  bool between{false};       // the last show() left channels between levels
+  uint8_t out[kBytes];        // scaled copy of one strip, sent instead of its buffer
+  uint8_t residue[2][kBytes]; // fraction of a level carried to the next frame
+#endif
+};
@@ -0,0 +1,263 @@
+#include "Effects.h"
+#include "Animation.h"
+#include "NoiseEffects.h"
+
+// Color
+uint8_t red = 255;
+uint8_t green = 255;
+uint8_t blue = 255;
+
+unsigned int pos = 0, dir = 1; // Position, direction of "eye" for larson scanner animation
+
+void ResetEffectState()
+{
+  red = green = blue = 255;
+  pos = 0;
+  dir = 1;
+  ResetRandom8();
+}
+
+// Draw the whole blade as it stands after the given wipe step, step 1 is the
+// first pixel of the first color.  Behind the front is the current color,
+// ahead of it what the previous wipe left; the first wipe draws over
+// whatever was on the blade.  Redrawing it all every step lets the frame
+// survive a setBrightness(), which rescales the pixel buffer lossily.
+static void DrawColorWipe(const ColorWipeState &s, uint32_t step)
+{
+  uint32_t wipe = (step - 1) / NUMPIXELS;
+  uint16_t front = (step - 1) % NUMPIXELS;
+  uint32_t color = pgm_read_dword(&s.colors[wipe % s.num_colors]);
+  uint32_t behind = pgm_read_dword(&s.colors[(wipe + s.num_colors - 1) % s.num_colors]);
+  uint16_t end = wipe ? NUMPIXELS - 1 : front;
+  for (uint16_t n = 0; n <= end; n++)
+  {
+    uint32_t c = n <= front ? color : behind;
+    if (s.rotate)
+    {
+      // the two sides wipe in opposite directions
+      pixel.setPixelColor(0, n, c);
+      pixel.setPixelColor(1, NUMPIXELS - n, c);
+    }
+    else
+    {
+      pixel.setPixelColor(n, c);
+    }
+  }
+}
+
+uint32_t ColorWipeFrame(ColorWipeState &s)
+{
+  int32_t elapsed = (int32_t)AnimationElapsed();
+  if (elapsed < 0)
+  {
+    return -elapsed; // started in the future, by a sync packet
+  }
+  uint32_t step = elapsed / s.wait;
+  if (step != s.steps)
+  {
+    s.steps = step;
+    if (step)
+    {
+      DrawColorWipe(s, step);
+      pixel.show();
+    }
+  }
+  return EffectToRealMs(s.wait - elapsed % s.wait);
+}
+
+// Fill the dots one after the other with each color of the palette in turn.
+// The position follows AnimationElapsed(), so synced swords wipe in step.
+void ColorWipeTask(Task &task)
+{
+  ColorWipeState &s = *static_cast<ColorWipeState *>(task.state);
+  TASK_BEGIN(task);
+  for (;;)
+  {
+    TASK_DELAY(task, ColorWipeFrame(s));
+  }
+  TASK_END(task);
+}
+
+// void colorWipe(uint32_t c, uint8_t wait)
+// {
+//   for (uint16_t i = 0; i < pixel.numPixels(); i++)
+//   {
+//     pixel.setPixelColor(i, c);
+//     pixel.show();
+//     delay(wait);
+//   }
+// }
+
+void larsonScanner(uint32_t c, uint8_t wait)
+{
+  int j;
+
+  for (uint16_t i = 0; i < pixel.numPixels() + 5; i++)
+  {
+    // Draw 5 pixels centered on pos.  setPixelColor() will clip any
+    // pixels off the ends of the strip, we don't need to watch for that.
+    pixel.setPixelColor(pos - 2, 0x003b85); // Dark red
+    pixel.setPixelColor(pos - 1, 0x005ed2); // Medium red
+    pixel.setPixelColor(pos, 0x00c0ff);     // Center pixel is brightest
+    pixel.setPixelColor(pos + 1, 0x005ed2); // Medium red
+    pixel.setPixelColor(pos + 2, 0x003b85); // Dark red
+
+    pixel.show();
+    delay(wait);
+
+    // Rather than being sneaky and erasing just the tail pixel,
+    // it's easier to erase it all and draw a new one next time.
+    for (j = -2; j <= 2; j++)
+      pixel.setPixelColor(pos + j, 0);
+
+    // Bounce off ends of strip
+    pos += dir;
+    if (pos < 0)
+    {
+      pos = 1;
+      dir = -dir;
+    }
+    else if (pos >= pixel.numPixels())
+    {
+      pos = pixel.numPixels() - 2;
+      dir = -dir;
+    }
+  }
+  // colorWipe(pixel.Color(0, 0, 0), 20);
+}
+
+void flashRandom(int wait, uint8_t howmany)
+{
+
+  for (uint16_t i = 0; i < howmany; i++)
+  {
+    // get a random pixel from the list
+    int j = random(pixel.numPixels());
+
+    // now we will 'fade' it in 5 steps
+    for (int x = 0; x < 5; x++)
+    {
+      int r = red * (x + 1);
+      r /= 5;
+      int g = green * (x + 1);
+      g /= 5;
+      int b = blue * (x + 1);
+      b /= 5;
+
+      pixel.setPixelColor(j, pixel.Color(r, g, b));
+      pixel.show();
+      delay(wait);
+    }
+    // & fade out in 5 steps
+    for (int x = 5; x >= 0; x--)
+    {
+      int r = red * x;
+      r /= 5;
+      int g = green * x;
+      g /= 5;
+      int b = blue * x;
+      b /= 5;
+
+      pixel.setPixelColor(j, pixel.Color(r, g, b));
+      pixel.show();
+      delay(wait);
+    }
+  }
+  // LEDs will be off when done (they are faded to 0)
+}
+
+void rainbow(uint8_t wait)
+{
+  uint16_t i, j;
+
+  for (j = 0; j < 256; j++)
+  {
+    for (i = 0; i < pixel.numPixels(); i++)
+    {
+      pixel.setPixelColor(i, Wheel((i + j) & 255));
+    }
+    pixel.show();
+    delay(wait);
+  }
+}
+
+// Slightly different, this makes the rainbow equally distributed throughout
+void rainbowCycle(uint8_t wait)
+{
+  uint16_t i, j;
+
+  for (j = 0; j < 256 * 5; j++)
+  { // 5 cycles of all colors on wheel
+    for (i = 0; i < pixel.numPixels(); i++)
+    {
+      pixel.setPixelColor(i, Wheel(((i * 256 / pixel.numPixels()) + j) & 255));
+    }
+    pixel.show();
+    delay(wait);
+  }
+}
+
+// Theatre-style crawling lights.
+void theaterChase(uint32_t c, uint8_t wait)
+{
+  for (int j = 0; j < 10; j++)
+  { // do 10 cycles of chasing
+    for (int q = 0; q < 3; q++)
+    {
+      for (uint8_t i = 0; i < pixel.numPixels(); i = i + 3)
+      {
+        pixel.setPixelColor(i + q, c); // turn every third pixel on
+      }
+      pixel.show();
+
+      delay(wait);
+
+      for (uint8_t i = 0; i < pixel.numPixels(); i = i + 3)
+      {
+        pixel.setPixelColor(i + q, 0); // turn every third pixel off
+      }
+    }
+  }
+}
+
+// Theatre-style crawling lights with rainbow effect
+void theaterChaseRainbow(uint8_t wait)
+{
+  for (int j = 0; j < 256; j++)
+  { // cycle all 256 colors in the wheel
+    for (int q = 0; q < 3; q++)
+    {
+      for (uint8_t i = 0; i < pixel.numPixels(); i = i + 3)
+      {
+        pixel.setPixelColor(i + q, Wheel((i + j) % 255)); // turn every third pixel on
+      }
+      pixel.show();
+
+      delay(wait);
+
+      for (uint8_t i = 0; i < pixel.numPixels(); i = i + 3)
+      {
+        pixel.setPixelColor(i + q, 0); // turn every third pixel off
+      }
+    }
+  }
+}
+
+// Input a value 0 to 255 to get a color value.
+// The colours are a transition r - g - b - back to r.
+uint32_t Wheel(byte WheelPos)
+{
+  WheelPos = 255 - WheelPos;
+  if (WheelPos < 85)
+  {
+    return pixel.Color(255 - WheelPos * 3, 0, WheelPos * 3);
+  }
+  if (WheelPos < 170)
+  {
+    WheelPos -= 85;
+    return pixel.Color(0, WheelPos * 3, 255 - WheelPos * 3);
+  }
+  WheelPos -= 170;
+  return pixel.Color(WheelPos * 3, 255 - WheelPos * 3, 0);
+}
+
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Platform.h"
+#include "BladeOutput.h"
+#include "BladeConfig.h"
+#include "Scheduler.h"
+
+// Color used by flashRandom()
+extern uint8_t red;
+extern uint8_t green;
+extern uint8_t blue;
+
+// nonblocking effects: scheduler tasks, see Scheduler.h
+struct ColorWipeState
+{
+  const uint32_t *colors; // palette in PROGMEM
+  uint8_t num_colors;
+  uint8_t wait;   // ms per pixel
+  bool rotate;    // wipe the second strip from the other end
+  uint32_t steps; // wipe steps drawn, AnimationElapsed() / wait
+};
+void ColorWipeTask(Task &task);
+// Draw the wipe as it stands at AnimationElapsed() if that is a new step,
+// returns the ms until the next step
+uint32_t ColorWipeFrame(ColorWipeState &s);
+
+// blocking effects
+void larsonScanner(uint32_t c, uint8_t wait);
+void flashRandom(int wait, uint8_t howmany);
+void rainbow(uint8_t wait);
+void rainbowCycle(uint8_t wait);
+void theaterChase(uint32_t c, uint8_t wait);
+void theaterChaseRainbow(uint8_t wait);
+
+uint32_t Wheel(byte WheelPos);
+
+// Put every effect back in its power-on state
+void ResetEffectState();
@@ -0,0 +1,194 @@
+#include "Ignition.h"
+#include "Animation.h"
+#include "Effects.h"
+#include "NoiseEffects.h"
+
+static const uint16_t kFullLength = 16384; // Q14
+
+// 65 points per curve from t = 0 to 1, Ease::Linear needs no table
+static const uint16_t ease_tables[(uint8_t)Ease::Count - 1][65] PROGMEM = {
+    // InOut: 4t^3, then 1 - (2 - 2t)^3 / 2
+    {0, 0, 2, 7, 16, 31, 54, 86, 128, 182, 250, 333, 432, 549, 686, 844,
+     1024, 1228, 1458, 1715, 2000, 2315, 2662, 3042, 3456, 3906, 4394, 4921, 5488, 6097, 6750, 7448,
+     8192, 8936, 9634, 10287, 10896, 11463, 11990, 12478, 12928, 13342, 13722, 14069, 14384, 14669, 14926, 15156,
+     15360, 15540, 15698, 15835, 15952, 16051, 16134, 16202, 16256, 16298, 16330, 16353, 16368, 16377, 16382, 16384,
+     16384},
+    // Overshoot: back ease out, 1 + 2.70158 (t - 1)^3 + 1.70158 (t - 1)^2, peaks at 1.1
+    {0, 1178, 2306, 3385, 4415, 5399, 6336, 7228, 8076, 8881, 9644, 10365, 11047, 11689, 12294, 12861,
+     13392, 13889, 14351, 14780, 15178, 15544, 15881, 16188, 16468, 16720, 16947, 17149, 17327, 17482, 17616, 17728,
+     17821, 17895, 17951, 17990, 18014, 18022, 18017, 18000, 17970, 17930, 17880, 17822, 17756, 17683, 17605, 17521,
+     17435, 17346, 17255, 17163, 17072, 16983, 16896, 16812, 16733, 16660, 16593, 16533, 16482, 16441, 16410, 16391,
+     16384},
+    // FlickerOn: 1 - (1 - t)^2 with dropouts at 6-7, 13-14, 22-23, 30 and 38
+    {0, 508, 1008, 1500, 1984, 2460, 1025, 678, 3840, 4284, 4720, 5148, 5568, 3289, 3830, 6780,
+     7168, 7548, 7920, 8284, 8640, 8988, 2798, 4347, 9984, 10300, 10608, 10908, 11200, 11484, 8820, 12028,
+     12288, 12540, 12784, 13020, 13248, 13468, 11628, 13884, 14080, 14268, 14448, 14620, 14784, 14940, 15088, 15228,
+     15360, 15484, 15600, 15708, 15808, 15900, 15984, 16060, 16128, 16188, 16240, 16284, 16320, 16348, 16368, 16380,
+     16384},
+};
+
+static Ease ignition_curve{Ease::Overshoot};
+static Ease retraction_curve{Ease::InOut};
+static uint16_t ignition_ms{IGNITION_MS};
+static uint16_t retraction_ms{RETRACTION_MS};
+
+static bool igniting;
+static uint16_t from_length;  // where the edge was when the motion started
+static uint16_t blade_length; // last drawn
+
+uint16_t EaseAt(Ease curve, uint16_t t)
+{
+  if (curve == Ease::Linear || curve >= Ease::Count)
+  {
+    return t >> 2;
+  }
+  const uint16_t *table = ease_tables[(uint8_t)curve - 1];
+  uint8_t i = t >> 10;
+  uint8_t frac = t >> 2;
+  int32_t a = pgm_read_word(&table[i]);
+  int32_t b = pgm_read_word(&table[i + 1]);
+  return a + (((b - a) * frac) >> 8);
+}
+
+void IgnitionConfigure(Ease ignition, uint16_t ignition_duration, Ease retraction, uint16_t retraction_duration)
+{
+  ignition_curve = ignition;
+  ignition_ms = ignition_duration;
+  retraction_curve = retraction;
+  retraction_ms = retraction_duration;
+}
+
+void StartBladeMotion(bool ignite, bool moving)
+{
+  igniting = ignite;
+  if (!moving)
+  {
+    blade_length = ignite ? 0 : kFullLength;
+  }
+  from_length = blade_length;
+}
+
+// Blade length elapsed ms into the motion, false once the motion is over
+static bool MotionLength(uint32_t elapsed, uint16_t *length)
+{
+  uint16_t duration = igniting ? ignition_ms : retraction_ms;
+  if (elapsed >= duration)
+  {
+    *length = igniting ? kFullLength : 0;
+    return false;
+  }
+  uint16_t e = EaseAt(igniting ? ignition_curve : retraction_curve, (elapsed << 16) / duration);
+  if (igniting)
+  {
+    int32_t to_go = (int32_t)kFullLength - from_length;
+    *length = from_length + ((to_go * e) >> 14);
+  }
+  else
+  {
+    uint32_t gone = ((uint32_t)from_length * e) >> 14;
+    *length = gone >= from_length ? 0 : from_length - gone;
+  }
+  return true;
+}
+
+void RenderBladeLength(uint16_t length)
+{
+  uint8_t r = red, g = green, b = blue;
+  if (length > kFullLength)
+  {
+    // overshoot: 1/8 of the blade past the tip is a full flash to white
+    uint16_t excess = length - kFullLength;
+    uint8_t flash = excess >= 2048 ? 255 : excess >> 3;
+    r += Scale8(255 - r, flash);
+    g += Scale8(255 - g, flash);
+    b += Scale8(255 - b, flash);
+    length = kFullLength;
+  }
+  uint32_t color = pixel.Color(r, g, b);
+
+  // in 1/256 pixels
+  uint32_t lit = ((uint32_t)length * NUMPIXELS) >> 6;
+  uint16_t whole = lit >> 8;
+  uint8_t edge = lit;
+  uint32_t edge_color = edge ? pixel.Color(Scale8(r, edge), Scale8(g, edge), Scale8(b, edge)) : 0;
+
+  for (uint16_t i = 0; i < NUMPIXELS; i++)
+  {
+    pixel.setPixelColor(i, i < whole ? color : i == whole ? edge_color : 0);
+  }
+}
+
+void ToggleBlade()
+{
+  bool lit;
+  if (current_mode == Mode::Ignition)
+  {
+    lit = true;
+  }
+  else if (current_mode == Mode::Retraction)
+  {
+    lit = false;
+  }
+  else
+  {
+    lit = !BladeDark();
+  }
+  StartMode(lit ? Mode::Retraction : Mode::Ignition);
+}
+
+// Draw the blade where the motion has got to, false once it is over
+static bool BladeMotionFrame()
+{
+  bool moving = MotionLength(AnimationElapsed(), &blade_length);
+  if (moving)
+  {
+    RenderBladeLength(blade_length);
+    pixel.show();
+  }
+  return moving;
+}
+
+static void FinishBladeMotion()
+{
+  if (igniting)
+  {
+    ShowStaticColor(red, green, blue);
+  }
+  else
+  {
+    RenderBladeLength(0);
+    pixel.show();
+    StartMode(Mode::Static);
+  }
+}
+
+void IgnitionTask(Task &task)
+{
+  TASK_BEGIN(task);
+  while (BladeMotionFrame())
+  {
+    TASK_SLEEP(task, IGNITION_FRAME_MS);
+  }
+  FinishBladeMotion();
+  TASK_END(task);
+}
+
+bool HandleIgnitionPacket(const uint8_t *packet)
+{
+  uint32_t in_curve, in_ms, out_curve, out_ms;
+  if (packet[0] != '!' || packet[1] != 'I')
+  {
+    return false;
+  }
+  if (!GetHex(packet + 2, 1, &in_curve) || !GetHex(packet + 3, 4, &in_ms) || !GetHex(packet + 7, 1, &out_curve) ||
+      !GetHex(packet + 8, 4, &out_ms))
+  {
+    return false;
+  }
+  if (in_curve >= (uint8_t)Ease::Count || out_curve >= (uint8_t)Ease::Count)
+  {
+    return false;
+  }
+  IgnitionConfigure((Ease)in_curve, in_ms, (Ease)out_curve, out_ms);
+  return true;
+}
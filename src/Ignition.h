@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Platform.h"
+#include "BladeOutput.h"
+#include "BladeConfig.h"
+#include "PacketStream.h"
+#include "Scheduler.h"
+
+/*=========================================================================
+    IGNITION
+
+    The blade extending from the hilt (Mode::Ignition) and collapsing back
+    into it (Mode::Retraction), in the current color.  The length of the
+    lit part follows an easing curve over a fixed duration, so it takes
+    the same time whatever the frame rate; the curves are tables in flash,
+    0..1 of the blade length in Q14, interpolated between entries.  The
+    pixel at the leading edge is lit in proportion to how much of it the
+    blade covers, which keeps slow ignitions from stepping pixel by pixel.
+    A curve that overshoots the full length shows the excess as a flash
+    of the whole blade towards white.
+
+    Ignition ends in Mode::Static with the color on the whole blade,
+    retraction in Mode::Static with the blade dark.  Either can start
+    while the other is under way, from wherever the edge is.  Button 1
+    on the Controller toggles the blade, unless a modulation slot is an
+    envelope: then button 1 is its gate (see Modulation.h).
+
+    Curves and durations are set over BLE:
+      '!' 'I' <ignition curve> <ignition ms, 4 digits>
+              <retraction curve> <retraction ms, 4 digits> <checksum>
+    with the numbers as hex, like the Sync packet.
+
+    IGNITION_FRAME_MS         Time between frames while the blade moves
+    IGNITION_MS               Default duration of an ignition
+    RETRACTION_MS             Default duration of a retraction
+    -----------------------------------------------------------------------*/
+#define IGNITION_FRAME_MS 10
+#define IGNITION_MS 400
+#define RETRACTION_MS 600
+
+enum class Ease : uint8_t
+{
+  Linear,
+  InOut,     // cubic ease in and out
+  Overshoot, // past the tip, flashing, then settling back
+  FlickerOn, // ease out with a few sputtering dropouts
+  Count
+};
+
+// 0..16384 (full length, more for Ease::Overshoot) at t = 0..65535
+uint16_t EaseAt(Ease curve, uint16_t t);
+
+void IgnitionConfigure(Ease ignition, uint16_t ignition_ms, Ease retraction, uint16_t retraction_ms);
+
+// Called by StartModeAt() for Mode::Ignition / Mode::Retraction; moving is
+// true if the blade was already igniting or retracting
+void StartBladeMotion(bool ignite, bool moving);
+
+// Draw the blade lit to length (Q14 of NUMPIXELS) with the leading edge
+// pixel partly lit, in the current color
+void RenderBladeLength(uint16_t length);
+
+// Ignite a dark blade, retract a lit one
+void ToggleBlade();
+
+void IgnitionTask(Task &task);
+
+// Decode an 'I' packet and apply it, false if it is malformed
+bool HandleIgnitionPacket(const uint8_t *packet);
@@ -0,0 +1,274 @@
+#include <string.h>
+#include "Modulation.h"
+#include "Animation.h"
+#include "BladeConfig.h"
+#include "Sync.h"
+
+// (1 - cos) / 2 over one period in 64 steps, 0..255
+static const uint8_t raised_cosine64[64] PROGMEM = {
+    0, 1, 2, 5, 10, 15, 21, 29, 37, 47, 57, 67, 79, 90, 103, 115,
+    127, 140, 152, 165, 176, 188, 198, 208, 218, 226, 234, 240, 245, 250, 253, 254,
+    255, 254, 253, 250, 245, 240, 234, 226, 218, 208, 198, 188, 176, 165, 152, 140,
+    128, 115, 103, 90, 79, 67, 57, 47, 37, 29, 21, 15, 10, 5, 2, 1};
+
+static const uint8_t mod_defaults[(uint8_t)ModTarget::Count] = {255, MOD_SPEED_NORMAL, 0, FIRE_COOLING, FIRE_SPARKING};
+
+uint8_t mod_params[(uint8_t)ModTarget::Count] = {255, MOD_SPEED_NORMAL, 0, FIRE_COOLING, FIRE_SPARKING};
+
+struct ModSlot
+{
+  ModShape shape;
+  ModTarget target;
+  uint8_t low;
+  uint8_t high;
+  uint16_t period_ms;
+  uint16_t attack_ms;
+  uint16_t decay_ms;
+  uint8_t sustain;
+  uint16_t release_ms;
+  uint8_t level;      // envelope output at the last update
+  uint8_t gate_level; // envelope output when the gate last changed
+};
+
+static const ModSlot kEmptySlot{ModShape::Off, ModTarget::Brightness, 0, 255, 1000, 100, 200, 192, 500, 0, 0};
+
+static ModSlot slots[MOD_SLOTS]{kEmptySlot, kEmptySlot, kEmptySlot, kEmptySlot};
+static_assert(MOD_SLOTS == 4, "update the slots initializer");
+
+static bool gate{false};
+static uint32_t gate_time; // millis() when the gate last opened or closed
+
+static uint8_t applied_brightness{255}; // last brightness handed to the blade
+static Task mod_task;
+
+// 0..255 at phase 0..65535
+static uint8_t Lfo(ModShape shape, uint16_t phase)
+{
+  switch (shape)
+  {
+  case ModShape::Sine:
+  {
+    uint8_t i = phase >> 10;
+    uint8_t frac = phase >> 2;
+    int16_t a = pgm_read_byte(&raised_cosine64[i]);
+    int16_t b = pgm_read_byte(&raised_cosine64[(i + 1) & 63]);
+    return a + (((b - a) * frac) >> 8);
+  }
+  case ModShape::Triangle:
+    return phase < 0x8000 ? phase >> 7 : (0xffff - phase) >> 7;
+  case ModShape::Saw:
+    return phase >> 8;
+  case ModShape::Square:
+    return phase < 0x8000 ? 0 : 255;
+  default:
+    return 0;
+  }
+}
+
+// Linear from `from` to `to` over length ms
+static uint8_t Ramp(uint8_t from, uint8_t to, uint32_t elapsed, uint16_t length)
+{
+  if (elapsed >= length)
+  {
+    return to;
+  }
+  return from + (int16_t)(((int32_t)((int16_t)to - from) * (int32_t)elapsed) / length);
+}
+
+// Attack and decay to sustain while the gate is open, release to 0 after.
+// Each phase starts from wherever the previous one got to, so a short tap
+// does not jump.
+static uint8_t Envelope(const ModSlot &s, uint32_t elapsed)
+{
+  if (!gate)
+  {
+    return Ramp(s.gate_level, 0, elapsed, s.release_ms);
+  }
+  if (elapsed < s.attack_ms)
+  {
+    return Ramp(s.gate_level, 255, elapsed, s.attack_ms);
+  }
+  return Ramp(255, s.sustain, elapsed - s.attack_ms, s.decay_ms);
+}
+
+static uint8_t SlotOutput(ModSlot &s, uint32_t now, uint32_t since_gate)
+{
+  if (s.shape == ModShape::Envelope)
+  {
+    s.level = Envelope(s, since_gate);
+    return s.level;
+  }
+  if (s.period_ms == 0)
+  {
+    return 0;
+  }
+  uint16_t phase = ((now % s.period_ms) << 16) / s.period_ms;
+  return Lfo(s.shape, phase);
+}
+
+// A slot to evaluate, or a brightness the blade has not taken yet
+static bool ModulationActive()
+{
+  for (uint8_t i = 0; i < MOD_SLOTS; i++)
+  {
+    if (slots[i].shape != ModShape::Off)
+    {
+      return true;
+    }
+  }
+  return mod_params[(uint8_t)ModTarget::Brightness] != applied_brightness;
+}
+
+void ModulationBind(uint8_t slot, ModShape shape, ModTarget target, uint8_t low, uint8_t high, uint16_t period_ms)
+{
+  if (slot >= MOD_SLOTS || target >= ModTarget::Count || shape > ModShape::Envelope)
+  {
+    return;
+  }
+  ModSlot &s = slots[slot];
+  s.shape = shape;
+  s.target = target;
+  s.low = low;
+  s.high = high;
+  s.period_ms = period_ms;
+  if (shape != ModShape::Off && !TaskRunning(mod_task))
+  {
+    TaskStart(mod_task, ModulationTask, nullptr);
+  }
+}
+
+void ModulationEnvelope(uint8_t slot, uint16_t attack_ms, uint16_t decay_ms, uint8_t sustain, uint16_t release_ms)
+{
+  if (slot >= MOD_SLOTS)
+  {
+    return;
+  }
+  ModSlot &s = slots[slot];
+  s.attack_ms = attack_ms;
+  s.decay_ms = decay_ms;
+  s.sustain = sustain;
+  s.release_ms = release_ms;
+}
+
+void ModulationGate(bool on)
+{
+  if (on == gate)
+  {
+    return;
+  }
+  for (uint8_t i = 0; i < MOD_SLOTS; i++)
+  {
+    slots[i].gate_level = slots[i].level;
+  }
+  gate = on;
+  gate_time = millis();
+}
+
+bool ModulationHasEnvelope()
+{
+  for (uint8_t i = 0; i < MOD_SLOTS; i++)
+  {
+    if (slots[i].shape == ModShape::Envelope)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ModulationReset()
+{
+  for (uint8_t i = 0; i < MOD_SLOTS; i++)
+  {
+    slots[i] = kEmptySlot;
+  }
+  gate = false;
+  memcpy(mod_params, mod_defaults, sizeof(mod_params));
+  // the task puts the default brightness back on the blade
+  if (ModulationActive() && !TaskRunning(mod_task))
+  {
+    TaskStart(mod_task, ModulationTask, nullptr);
+  }
+}
+
+bool ModulationUpdate()
+{
+  uint8_t values[(uint8_t)ModTarget::Count];
+  memcpy(values, mod_defaults, sizeof(values));
+
+  uint32_t now = AnimationTime();
+  uint32_t since_gate = millis() - gate_time;
+  for (uint8_t i = 0; i < MOD_SLOTS; i++)
+  {
+    ModSlot &s = slots[i];
+    if (s.shape == ModShape::Off)
+    {
+      continue;
+    }
+    // 0..256, so that 255 reaches high exactly
+    uint16_t out = SlotOutput(s, now, since_gate);
+    out += out >> 7;
+    values[(uint8_t)s.target] = s.low + (((int32_t)s.high - s.low) * out >> 8);
+  }
+
+  bool changed = memcmp(values, mod_params, sizeof(values)) != 0;
+  memcpy(mod_params, values, sizeof(values));
+  return changed;
+}
+
+// Hand a new brightness to the blade; retried every frame until the
+// current animation can take it
+static void ApplyModulation()
+{
+  uint8_t level = mod_params[(uint8_t)ModTarget::Brightness];
+  if (level != applied_brightness && SetBladeBrightness(level))
+  {
+    applied_brightness = level;
+  }
+}
+
+void ModulationTask(Task &task)
+{
+  TASK_BEGIN(task);
+  for (;;)
+  {
+    ModulationUpdate();
+    ApplyModulation();
+    if (!ModulationActive())
+    {
+      break; // every parameter is back at its default
+    }
+    TASK_SLEEP(task, MOD_FRAME_MS);
+  }
+  TASK_END(task);
+}
+
+bool HandleModulationPacket(const uint8_t *packet)
+{
+  uint32_t slot, a, b, c, d, e;
+  if (packet[0] != '!')
+  {
+    return false;
+  }
+  if (packet[1] == 'P')
+  {
+    if (!GetHex(packet + 2, 1, &slot) || !GetHex(packet + 3, 1, &a) || !GetHex(packet + 4, 1, &b) ||
+        !GetHex(packet + 5, 4, &c) || !GetHex(packet + 9, 2, &d) || !GetHex(packet + 11, 2, &e))
+    {
+      return false;
+    }
+    ModulationBind(slot, (ModShape)a, (ModTarget)b, d, e, c);
+    return true;
+  }
+  if (packet[1] == 'E')
+  {
+    if (!GetHex(packet + 2, 1, &slot) || !GetHex(packet + 3, 4, &a) || !GetHex(packet + 7, 4, &b) ||
+        !GetHex(packet + 11, 2, &c) || !GetHex(packet + 13, 4, &d))
+    {
+      return false;
+    }
+    ModulationEnvelope(slot, a, b, c, d);
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Platform.h"
+#include "PacketStream.h"
+#include "Scheduler.h"
+
+/*=========================================================================
+    MODULATION
+
+    Breathing, pulsing and ramping looks on top of the existing effects.
+    Each of the MOD_SLOTS slots drives one effect parameter (ModTarget)
+    back and forth between a low and a high value, with an LFO shape or an
+    ADSR envelope as the source.  The slots are evaluated once per frame
+    by ModulationTask, which writes mod_params[]; the effects read their
+    parameter from there instead of a fixed value.
+
+    LFO phase follows AnimationTime(), so synced swords pulse together.
+    The envelope follows a gate: button 1 held down on the Controller.
+    While no slot is an envelope, button 1 ignites and retracts the blade
+    instead (see Ignition.h).
+
+    Slots are set over BLE, in the Sync packet style with hex numbers:
+      '!' 'P' <slot> <shape> <target> <period ms, 4 digits>
+              <low, 2 digits> <high, 2 digits> <checksum>
+      '!' 'E' <slot> <attack ms, 4 digits> <decay ms, 4 digits>
+              <sustain level, 2 digits> <release ms, 4 digits> <checksum>
+    Shape ModShape::Off clears the slot, and its target goes back to the
+    default value.
+
+    MOD_SLOTS                 How many parameters can be modulated at once
+    MOD_FRAME_MS              Time between evaluations
+    -----------------------------------------------------------------------*/
+#define MOD_SLOTS 4
+#define MOD_FRAME_MS 16
+
+enum class ModShape : uint8_t
+{
+  Off,
+  Sine,     // raised cosine, starts at low
+  Triangle,
+  Saw,      // ramps up, then drops back to low
+  Square,
+  Envelope  // ADSR, see ModulationEnvelope()
+};
+
+enum class ModTarget : uint8_t
+{
+  Brightness,   // of the whole blade, 255 = full
+  Speed,        // of the animation, 128 = normal, 255 = almost twice as fast
+  Hue,          // added to the Wheel() position of the colorful effects
+  FireCooling,  // FIRE_COOLING
+  FireSparking, // FIRE_SPARKING
+  Count
+};
+
+#define MOD_SPEED_NORMAL 128
+
+// Current value of every ModTarget, read by the effects
+extern uint8_t mod_params[(uint8_t)ModTarget::Count];
+
+// Set a slot to move target between low and high with shape, one cycle per period_ms
+void ModulationBind(uint8_t slot, ModShape shape, ModTarget target, uint8_t low, uint8_t high, uint16_t period_ms);
+// ADSR times of a slot with ModShape::Envelope
+void ModulationEnvelope(uint8_t slot, uint16_t attack_ms, uint16_t decay_ms, uint8_t sustain, uint16_t release_ms);
+// Open or close the gate of every envelope
+void ModulationGate(bool on);
+// True if a slot is set to ModShape::Envelope
+bool ModulationHasEnvelope();
+// Clear every slot
+void ModulationReset();
+
+// Evaluate every slot once, returns true if a parameter changed
+bool ModulationUpdate();
+
+// Evaluates the slots every MOD_FRAME_MS and applies the blade brightness;
+// ModulationBind() starts it, it stops once every slot is off
+void ModulationTask(Task &task);
+
+// Decode a 'P' or 'E' packet and apply it, false if it is malformed
+bool HandleModulationPacket(const uint8_t *packet);
@@ -0,0 +1,239 @@
+#include <string.h>
+#include "NoiseEffects.h"
+#include "Effects.h"
+#include "Animation.h"
+#include "Modulation.h"
+
+// Ken Perlin's permutation of 0..255
+static const uint8_t perm[256] PROGMEM = {
+    151, 160, 137, 91, 90, 15, 131, 13, 201, 95, 96, 53, 194, 233, 7, 225,
+    140, 36, 103, 30, 69, 142, 8, 99, 37, 240, 21, 10, 23, 190, 6, 148,
+    247, 120, 234, 75, 0, 26, 197, 62, 94, 252, 219, 203, 117, 35, 11, 32,
+    57, 177, 33, 88, 237, 149, 56, 87, 174, 20, 125, 136, 171, 168, 68, 175,
+    74, 165, 71, 134, 139, 48, 27, 166, 77, 146, 158, 231, 83, 111, 229, 122,
+    60, 211, 133, 230, 220, 105, 92, 41, 55, 46, 245, 40, 244, 102, 143, 54,
+    65, 25, 63, 161, 1, 216, 80, 73, 209, 76, 132, 187, 208, 89, 18, 169,
+    200, 196, 135, 130, 116, 188, 159, 86, 164, 100, 109, 198, 173, 186, 3, 64,
+    52, 217, 226, 250, 124, 123, 5, 202, 38, 147, 118, 126, 255, 82, 85, 212,
+    207, 206, 59, 227, 47, 16, 58, 17, 182, 189, 28, 42, 223, 183, 170, 213,
+    119, 248, 152, 2, 44, 154, 163, 70, 221, 153, 101, 155, 167, 43, 172, 9,
+    129, 22, 39, 253, 19, 98, 108, 110, 79, 113, 224, 232, 178, 185, 112, 104,
+    218, 246, 97, 228, 251, 34, 242, 193, 238, 210, 144, 12, 191, 179, 162, 241,
+    81, 51, 145, 235, 249, 14, 239, 107, 49, 192, 214, 31, 181, 199, 106, 157,
+    184, 84, 204, 176, 115, 121, 50, 45, 127, 4, 150, 254, 138, 236, 205, 93,
+    222, 114, 67, 29, 24, 72, 243, 141, 128, 195, 78, 66, 215, 61, 156, 180,
+};
+
+static const uint16_t kNoiseSeed = 0xACE1;
+static uint16_t noise_seed{kNoiseSeed};
+static uint8_t heat[2][NUMPIXELS];
+
+static inline uint8_t Perm(uint8_t i)
+{
+  return pgm_read_byte(&perm[i]);
+}
+
+// quadratic ease in/out of a 0..255 fraction
+static inline uint8_t Ease8(uint8_t f)
+{
+  if (f < 128)
+  {
+    return Scale8(f, f) << 1;
+  }
+  uint8_t g = 255 - f;
+  return 255 - (Scale8(g, g) << 1);
+}
+
+static inline uint8_t Lerp8(uint8_t a, uint8_t b, uint8_t t)
+{
+  return b >= a ? a + Scale8(b - a, t) : a - Scale8(a - b, t);
+}
+
+static inline uint8_t Add8(uint8_t a, uint8_t b)
+{
+  uint16_t sum = (uint16_t)a + b;
+  return sum > 255 ? 255 : sum;
+}
+
+// 0 .. n-1 without a division
+static inline uint8_t Random8(uint8_t n)
+{
+  return ((uint16_t)Random8() * n) >> 8;
+}
+
+static uint32_t ScaleColor(uint32_t c, uint8_t scale)
+{
+  return pixel.Color(Scale8(c >> 16, scale), Scale8(c >> 8, scale), Scale8(c, scale));
+}
+
+uint8_t Scale8(uint8_t v, uint8_t scale)
+{
+  return ((uint16_t)v * (1 + (uint16_t)scale)) >> 8;
+}
+
+// xorshift16, much cheaper than random() which does 32-bit divisions
+uint8_t Random8()
+{
+  noise_seed ^= noise_seed << 7;
+  noise_seed ^= noise_seed >> 9;
+  noise_seed ^= noise_seed << 8;
+  return noise_seed >> 8;
+}
+
+void ResetRandom8()
+{
+  noise_seed = kNoiseSeed;
+}
+
+uint8_t Noise8(uint16_t x, uint16_t y)
+{
+  uint8_t xi = x >> 8;
+  uint8_t yi = y >> 8;
+  uint8_t xf = Ease8(x);
+  uint8_t yf = Ease8(y);
+
+  uint8_t a = Perm(xi) + yi;
+  uint8_t b = Perm(xi + 1) + yi;
+
+  uint8_t bottom = Lerp8(Perm(a), Perm(b), xf);
+  uint8_t top = Lerp8(Perm(a + 1), Perm(b + 1), xf);
+  return Lerp8(bottom, top, yf);
+}
+
+// Black through red and yellow to white
+uint32_t HeatColor(uint8_t temperature)
+{
+  uint8_t t192 = Scale8(temperature, 191);
+  uint8_t ramp = (t192 & 0x3F) << 2;
+  if (t192 & 0x80)
+  {
+    return pixel.Color(255, 255, ramp);
+  }
+  if (t192 & 0x40)
+  {
+    return pixel.Color(255, ramp, 0);
+  }
+  return pixel.Color(ramp, 0, 0);
+}
+
+void StartNoiseEffect()
+{
+  memset(heat, 0, sizeof(heat));
+}
+
+// 10 / NUMPIXELS in Q16, rounded up, so cooling * 10 / NUMPIXELS needs no
+// division at run time; exact for every cooling up to 332 pixels
+static const uint32_t kCoolingPerPixel = ((10UL << 16) + NUMPIXELS - 1) / NUMPIXELS;
+static_assert(NUMPIXELS < 333, "kCoolingPerPixel is no longer exact");
+
+// Heat rises from the hilt (pixel 0) and diffuses upwards, independently on each side
+void RenderFire()
+{
+  // maximum cooling per pixel and frame, scaled so the flame height does not depend on NUMPIXELS
+  uint8_t cool_max = (((uint32_t)mod_params[(uint8_t)ModTarget::FireCooling] * kCoolingPerPixel) >> 16) + 2;
+  uint8_t sparking = mod_params[(uint8_t)ModTarget::FireSparking];
+
+  for (uint8_t s = 0; s < 2; s++)
+  {
+    uint8_t *h = heat[s];
+
+    for (uint16_t i = 0; i < NUMPIXELS; i++)
+    {
+      uint8_t cooldown = Random8(cool_max);
+      h[i] = h[i] > cooldown ? h[i] - cooldown : 0;
+    }
+
+    // (a + 2b) / 3 as (a + 2b) * 85 / 256
+    for (uint16_t k = NUMPIXELS - 1; k >= 2; k--)
+    {
+      h[k] = ((uint16_t)(h[k - 1] + h[k - 2] + h[k - 2]) * 85) >> 8;
+    }
+
+    if (Random8() < sparking)
+    {
+      uint8_t y = Random8(7);
+      h[y] = Add8(h[y], 160 + Random8(96));
+    }
+
+    for (uint16_t i = 0; i < NUMPIXELS; i++)
+    {
+      pixel.setPixelColor(s, i, HeatColor(h[i]));
+    }
+  }
+}
+
+// Two octaves of noise through Wheel(), drifting along the blade
+void RenderPlasma(uint16_t t)
+{
+  uint8_t hue = mod_params[(uint8_t)ModTarget::Hue];
+  for (uint8_t s = 0; s < 2; s++)
+  {
+    uint16_t y = t + (s ? 0x5555 : 0);
+    for (uint16_t i = 0; i < NUMPIXELS; i++)
+    {
+      uint8_t n = (Noise8(i << 5, y) >> 1) + (Noise8(i << 6, (y << 1) + 0x2222) >> 1);
+      pixel.setPixelColor(s, i, Wheel(n + (t >> 4) + hue));
+    }
+  }
+}
+
+// The current color with an unstable, crackling brightness
+void RenderFlicker(uint16_t t)
+{
+  uint32_t c = pixel.Color(red, green, blue);
+  uint8_t surge = Noise8(0x1000, t << 1) >> 2;
+  for (uint8_t s = 0; s < 2; s++)
+  {
+    uint16_t y = (t << 3) + (s ? 0x3333 : 0);
+    for (uint16_t i = 0; i < NUMPIXELS; i++)
+    {
+      uint8_t n = Noise8(i << 6, y);
+      uint8_t level = 255 - Scale8(Add8(n, surge), 150);
+      pixel.setPixelColor(s, i, ScaleColor(c, level));
+    }
+  }
+}
+
+void FireTask(Task &task)
+{
+  TASK_BEGIN(task);
+  for (;;)
+  {
+    // the first frame comes one frame time after the start, like every other
+    TASK_SLEEP(task, EffectToRealMs(NOISE_FRAME_MS));
+    RenderFire();
+    pixel.show();
+  }
+  TASK_END(task);
+}
+
+// ms to the next frame on the AnimationElapsed() grid, so synced swords
+// render their frames at the same instants
+static uint32_t UntilNextFrame()
+{
+  return EffectToRealMs(NOISE_FRAME_MS - AnimationElapsed() % NOISE_FRAME_MS);
+}
+
+void PlasmaTask(Task &task)
+{
+  TASK_BEGIN(task);
+  for (;;)
+  {
+    TASK_DELAY(task, UntilNextFrame());
+    RenderPlasma(AnimationElapsed() >> 3);
+    pixel.show();
+  }
+  TASK_END(task);
+}
+
+void FlickerTask(Task &task)
+{
+  TASK_BEGIN(task);
+  for (;;)
+  {
+    TASK_DELAY(task, UntilNextFrame());
+    RenderFlicker(AnimationElapsed() >> 2);
+    pixel.show();
+  }
+  TASK_END(task);
+}
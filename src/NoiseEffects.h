@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Platform.h"
+#include "BladeOutput.h"
+#include "BladeConfig.h"
+#include "Scheduler.h"
+
+/*=========================================================================
+    NOISE EFFECTS
+
+    Fire, plasma and flicker built on an 8-bit value noise function and a
+    heat diffusion kernel.  Everything is 8/16-bit integer math with shifts
+    and small multiplies only: no floats and no divisions on the AVR.
+
+    Each effect has a Render function that only writes pixels (used by the
+    host benchmark) and a scheduler task that renders and shows one frame
+    every NOISE_FRAME_MS.
+    -----------------------------------------------------------------------*/
+
+// v * scale / 256, with scale 255 leaving v unchanged
+uint8_t Scale8(uint8_t v, uint8_t scale);
+
+// Fast 8-bit pseudo random number
+uint8_t Random8();
+// Restart Random8() from its power-on seed
+void ResetRandom8();
+
+// Smooth 2D value noise in 0..255; x and y are 8.8 fixed point lattice coordinates
+uint8_t Noise8(uint16_t x, uint16_t y);
+
+// Black body color of a 0..255 temperature
+uint32_t HeatColor(uint8_t temperature);
+
+// Reset the fire; call when entering any noise mode
+void StartNoiseEffect();
+
+void RenderFire();
+void RenderPlasma(uint16_t t);
+void RenderFlicker(uint16_t t);
+
+void FireTask(Task &task);
+void PlasmaTask(Task &task);
+void FlickerTask(Task &task);
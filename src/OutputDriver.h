@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+/*=========================================================================
+    OUTPUT DRIVER
+
+    Everything an effect needs from the thing it draws on.  Effects only
+    talk to the global `pixel`, so the same effect code drives the
+    NeoPixel strips on the sword (DualNeopixel) and a frame sink on a
+    Linux host (host/FrameSinkOutput).  Which one `pixel` is gets picked
+    at build time in BladeOutput.h rather than through virtual calls:
+    effects write every pixel of every frame, and on the AVR an indirect
+    call per pixel would undo the unrolled loops DualNeopixel<N> gets
+    from its constant pixel count.
+
+    A driver derives from OutputDriver and provides:
+
+      void begin();
+
+      // write the same color to pixel n of both strips
+      void setPixelColor(uint16_t n, uint32_t c);
+
+      // write pixel n of one strip only (false = first strip, true = second)
+      void setPixelColor(bool strip, uint16_t n, uint32_t c);
+
+      // send the pixels to the blade; a driver may skip this when nothing
+      // changed since the last show(), so a static blade costs nothing
+      void show();
+      void setBrightness(uint8_t b);
+      uint16_t numPixels() const;
+
+      // true while the last show() left a channel between two levels, so
+      // another show() would differ even with no pixel changed (see Dither.h)
+      bool dithering() const;
+
+      // show() calls that sent the strips
+      uint32_t framesShown() const;
+    -----------------------------------------------------------------------*/
+class OutputDriver
+{
+public:
+  // Same packing as Adafruit_NeoPixel::Color(), but usable in constant expressions
+  static constexpr uint32_t Color(uint8_t r, uint8_t g, uint8_t b)
+  {
+    return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+  }
+};
@@ -0,0 +1,192 @@
+#include <string.h>
+#include "PacketStream.h"
+
+/* Buffer to hold incoming characters */
+uint8_t packetbuffer[READ_BUFSIZE + 1];
+ParserStats parser_stats;
+
+// bytes of the packet being received, and after a resync whatever followed it
+static uint8_t work[READ_BUFSIZE];
+static uint8_t replyidx{0};
+static uint32_t last_byte_time;
+
+void ResetPacketParser()
+{
+  replyidx = 0;
+  memset(packetbuffer, 0, sizeof(packetbuffer));
+}
+
+// Length of a packet of this type, 0 for unknown types
+static uint8_t ExpectedLength(uint8_t type)
+{
+  switch (type)
+  {
+  case 'A':
+    return PACKET_ACC_LEN;
+  case 'G':
+    return PACKET_GYRO_LEN;
+  case 'M':
+    return PACKET_MAG_LEN;
+  case 'Q':
+    return PACKET_QUAT_LEN;
+  case 'B':
+    return PACKET_BUTTON_LEN;
+  case 'C':
+    return PACKET_COLOR_LEN;
+  case 'L':
+    return PACKET_LOCATION_LEN;
+  case 'S':
+    return PACKET_SYNC_LEN;
+  case 'P':
+    return PACKET_MODPARAM_LEN;
+  case 'E':
+    return PACKET_ENVELOPE_LEN;
+  case 'I':
+    return PACKET_IGNITION_LEN;
+  default:
+    return 0;
+  }
+}
+
+static bool ChecksumOk(uint8_t len)
+{
+  uint8_t xsum = 0;
+  for (uint8_t i = 0; i < len - 1; i++)
+  {
+    xsum += work[i];
+  }
+  return (uint8_t)~xsum == work[len - 1];
+}
+
+static void Drop(uint8_t n)
+{
+  replyidx -= n;
+  memmove(work, work + n, replyidx);
+}
+
+// Index of the first '!' in work at or after from, replyidx if there is none
+static uint8_t NextStart(uint8_t from)
+{
+  while (from < replyidx && work[from] != '!')
+  {
+    from++;
+  }
+  return from;
+}
+
+// Drop the packet at the start of work and carry on from the next '!' in it
+static void Resync()
+{
+  uint8_t next = NextStart(1);
+  if (next < replyidx)
+  {
+    parser_stats.resyncs++;
+  }
+  Drop(next);
+}
+
+// Decide what the bytes in work are: the length of the valid packet now
+// copied to packetbuffer, or 0 when more bytes are needed
+static uint8_t CheckPacket()
+{
+  while (replyidx >= 2)
+  {
+    uint8_t len = ExpectedLength(work[1]);
+    if (len == 0)
+    {
+      parser_stats.unknown_types++;
+    }
+    else if (replyidx < len)
+    {
+      return 0;
+    }
+    else if (ChecksumOk(len))
+    {
+      memcpy(packetbuffer, work, len);
+      packetbuffer[len] = 0; // null term
+      Drop(len);
+      parser_stats.packets++;
+      // anything after the packet is noise up to the next '!'
+      uint8_t next = NextStart(0);
+      parser_stats.noise_bytes += next;
+      Drop(next);
+      return len;
+    }
+    else
+    {
+      parser_stats.checksum_errors++;
+    }
+    Resync();
+  }
+  return 0;
+}
+
+uint8_t ParsePacket(RxRing &ring, uint16_t timeout)
+{
+  // a resync can leave a whole packet behind in work
+  uint8_t len = CheckPacket();
+  if (len)
+  {
+    return len;
+  }
+
+  if (replyidx && !RxCount(ring) && millis() - last_byte_time > timeout)
+  {
+    // the rest of this packet is not coming
+    parser_stats.timeouts++;
+    Resync();
+    len = CheckPacket();
+    if (len)
+    {
+      return len;
+    }
+  }
+
+  while (RxCount(ring))
+  {
+    uint8_t c = RxPop(ring);
+    last_byte_time = millis();
+    if (replyidx == 0 && c != '!')
+    {
+      parser_stats.noise_bytes++;
+      continue;
+    }
+    work[replyidx++] = c;
+    len = CheckPacket();
+    if (len)
+    {
+      return len;
+    }
+  }
+  return 0;
+}
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+void PutHex(uint8_t *buf, uint32_t value, uint8_t digits)
+{
+  for (int8_t i = digits - 1; i >= 0; i--)
+  {
+    buf[i] = hex_digits[value & 0xf];
+    value >>= 4;
+  }
+}
+
+bool GetHex(const uint8_t *buf, uint8_t digits, uint32_t *value)
+{
+  uint32_t v = 0;
+  for (uint8_t i = 0; i < digits; i++)
+  {
+    uint8_t c = buf[i];
+    uint8_t d;
+    if (c >= '0' && c <= '9')
+      d = c - '0';
+    else if (c >= 'A' && c <= 'F')
+      d = c - 'A' + 10;
+    else
+      return false;
+    v = (v << 4) | d;
+  }
+  *value = v;
+  return true;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "Platform.h"
+
+/*=========================================================================
+    PACKET STREAM
+
+    Bytes from the Bluefruit module are first moved in bulk into a receive
+    ring (RxFill), then the Controller packets are cut out of the ring by
+    an incremental parser (ParsePacket).  Neither call blocks: a packet
+    that is only partly here simply stays in the parser until the rest
+    arrives, instead of readPacket() sitting in delay(1) waiting for it.
+
+    Every packet type has a fixed length, so a '!' inside a packet is
+    taken as payload (colors, floats and checksums can be 0x21).  When a
+    packet turns out bad, because its checksum is wrong or its type byte
+    is not one we know, the parser restarts at the next '!' it already
+    has instead of dropping everything it read: after a lost byte the
+    following packet usually starts inside the bad one.  An unknown type
+    is rejected as soon as it arrives, not READ_BUFSIZE bytes later.
+
+    PACKET_*_LEN              Length of each Controller packet type, '!' and
+                              checksum included
+    READ_BUFSIZE              Size of the buffer for one packet
+    BLE_RX_BUFSIZE            Size of the receive ring, a power of two <= 128
+    -----------------------------------------------------------------------*/
+#define PACKET_ACC_LEN (15)
+#define PACKET_GYRO_LEN (15)
+#define PACKET_MAG_LEN (15)
+#define PACKET_QUAT_LEN (19)
+#define PACKET_BUTTON_LEN (5)
+#define PACKET_COLOR_LEN (6)
+#define PACKET_LOCATION_LEN (15)
+#define PACKET_SYNC_LEN (20)
+#define PACKET_MODPARAM_LEN (14)
+#define PACKET_ENVELOPE_LEN (18)
+#define PACKET_IGNITION_LEN (13)
+
+#define READ_BUFSIZE (20)
+#define BLE_RX_BUFSIZE (64)
+
+struct RxRing
+{
+  uint8_t data[BLE_RX_BUFSIZE];
+  uint8_t head; // free running, masked on access
+  uint8_t tail;
+};
+
+inline uint8_t RxCount(const RxRing &ring)
+{
+  return (uint8_t)(ring.head - ring.tail);
+}
+
+inline uint8_t RxFree(const RxRing &ring)
+{
+  return BLE_RX_BUFSIZE - RxCount(ring);
+}
+
+inline void RxPush(RxRing &ring, uint8_t c)
+{
+  ring.data[ring.head++ & (BLE_RX_BUFSIZE - 1)] = c;
+}
+
+inline uint8_t RxPop(RxRing &ring)
+{
+  return ring.data[ring.tail++ & (BLE_RX_BUFSIZE - 1)];
+}
+
+/**************************************************************************/
+/*!
+    @brief  Move everything the BLE module has buffered into ring
+
+    On Adafruit_BluefruitLE_SPI available() only talks to the module when
+    the library's own FIFO is empty; it then fetches a whole SDEP packet
+    (up to 16 bytes) in one transaction, and the read()s that follow are
+    served from memory.  So this costs one transaction per 16 bytes plus
+    one to find out the module is empty, however many packets are queued.
+*/
+/**************************************************************************/
+template <class BleStream>
+uint8_t RxFill(RxRing &ring, BleStream &ble)
+{
+  uint8_t total = 0;
+  while (RxFree(ring))
+  {
+    int n = ble.available();
+    if (n <= 0)
+    {
+      break;
+    }
+    if (n > RxFree(ring))
+    {
+      n = RxFree(ring);
+    }
+    for (int i = 0; i < n; i++)
+    {
+      RxPush(ring, ble.read());
+    }
+    total += n;
+  }
+  return total;
+}
+
+// Numbers in the packets this firmware defines itself ('S', 'P', 'E', 'I') are
+// upper case hex, most significant digit first, so they stay printable
+void PutHex(uint8_t *buf, uint32_t value, uint8_t digits);
+// false if one of the digits is not hex
+bool GetHex(const uint8_t *buf, uint8_t digits, uint32_t *value);
+
+// the packet buffer, holds the last packet returned by ParsePacket()
+extern uint8_t packetbuffer[];
+
+// What the parser has seen since power on (counters wrap)
+struct ParserStats
+{
+  uint16_t packets;         // checksum-valid packets returned
+  uint16_t checksum_errors; // complete packets with a wrong checksum
+  uint16_t unknown_types;   // rejected at the type byte
+  uint16_t resyncs;         // restarts at a '!' inside a rejected packet
+  uint16_t timeouts;        // partial packets given up on
+  uint16_t noise_bytes;     // bytes outside any packet, skipped
+};
+
+extern ParserStats parser_stats;
+
+// Forget any partly received packet
+void ResetPacketParser();
+
+/**************************************************************************/
+/*!
+    @brief  Consume bytes from ring until one packet is complete
+
+    @return Length of the checksum-valid packet now in packetbuffer, or 0 if
+            the ring ran out first.  Bytes after the packet stay in the
+            ring (or the parser) for the next call.  A partial packet is
+            dropped after timeout ms without new bytes.
+*/
+/**************************************************************************/
+uint8_t ParsePacket(RxRing &ring, uint16_t timeout);
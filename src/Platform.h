@@ -0,0 +1,34 @@
+#pragma once
+
+/*=========================================================================
+    PLATFORM
+
+    The handful of Arduino core calls the effect code relies on.  On the
+    sword this is just Arduino.h; on a Linux host they are provided by
+    host/HostPlatform.cpp against a simulated clock, so effects that call
+    delay() render instantly instead of in real time.
+    -----------------------------------------------------------------------*/
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+long random(long howbig);
+long random(long howsmall, long howbig);
+
+// there are no interrupts to mask on the host
+inline void noInterrupts() {}
+inline void interrupts() {}
+#endif
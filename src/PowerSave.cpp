@@ -0,0 +1,114 @@
+#include "PowerSave.h"
+#include "Scheduler.h"
+
+#ifdef __AVR__
+#include <avr/sleep.h>
+
+// wiring.c's millis() and micros() state
+extern volatile unsigned long timer0_millis;
+extern volatile unsigned long timer0_overflow_count;
+
+// timer0 and timer3 both count at clk/64
+static const uint16_t kTicksPerMs = F_CPU / 64 / 1000;
+static const uint16_t kUsPerOverflow = clockCyclesToMicroseconds(64 * 256);
+static uint16_t carry_us; // slept time not added to millis() yet, under 1 ms
+
+// only there to end the sleep
+EMPTY_INTERRUPT(TIMER3_COMPA_vect);
+
+// TCNT0, waiting out the last tick before an overflow so that TOV0 cannot
+// change in the next few instructions
+static uint8_t ReadTimer0()
+{
+  uint8_t t;
+  while ((t = TCNT0) == 255)
+  {
+  }
+  return t;
+}
+#endif
+
+PowerStats power_stats;
+
+void IdleSleep(const volatile bool *pending)
+{
+#ifdef __AVR__
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  uint32_t start = micros();
+  noInterrupts();
+  uint32_t idle = SchedulerIdleTime();
+  uint8_t t0 = ReadTimer0();
+  if (idle == 0 || (pending && *pending) || (TIFR0 & _BV(TOV0)))
+  {
+    // something to do, or a millis() tick the ISR has not counted yet
+    interrupts();
+    return;
+  }
+
+  // wake at the first overflow that puts millis() at or past the wake time,
+  // two ticks late so it has certainly happened
+  uint32_t overflows = ((idle > 0xffff ? 0xffff : idle) * kTicksPerMs + 255) >> 8;
+  if (overflows > 255)
+  {
+    overflows = 255; // timer3 is 16 bits
+  }
+  TCCR3A = 0;
+  TCCR3B = 0;
+  TCNT3 = 0;
+  OCR3A = (overflows << 8) - t0 + 2;
+  TIFR3 = _BV(OCF3A);
+  TIMSK3 = _BV(OCIE3A);
+  TCCR3B = _BV(CS31) | _BV(CS30);
+  TIMSK0 &= ~_BV(TOIE0);
+
+  sleep_enable();
+  // the instruction after sei always runs, so no interrupt can slip in
+  // between the checks above and the sleep
+  interrupts();
+  sleep_cpu();
+  sleep_disable();
+
+  noInterrupts();
+  uint16_t slept = TCNT3;
+  TCCR3B = 0;
+  TIMSK3 = 0;
+  // timer0 kept counting, every wrap of it since t0 is an overflow the ISR
+  // missed; the two counters can be a tick apart, hence the rounding
+  uint8_t t1 = ReadTimer0();
+  TIFR0 = _BV(TOV0);
+  uint16_t missed = ((int32_t)t0 + slept - t1 + 128) >> 8;
+  timer0_overflow_count += missed;
+  uint32_t us = (uint32_t)missed * kUsPerOverflow + carry_us;
+  timer0_millis += us / 1000;
+  carry_us = us % 1000;
+  TIMSK0 |= _BV(TOIE0);
+  interrupts();
+
+  power_stats.wakeups++;
+  power_stats.sleep_us += micros() - start;
+#else
+  (void)pending;
+#endif
+}
+
+uint8_t PowerDutyCycle()
+{
+  uint32_t elapsed = micros() - power_stats.since_us;
+  if (elapsed == 0)
+  {
+    return 100;
+  }
+  // in 1/256 us steps so the product fits, the stats are reset every few seconds
+  return 100 - (uint8_t)(((power_stats.sleep_us >> 8) * 100) / ((elapsed >> 8) | 1));
+}
+
+uint16_t PowerWakeupRate()
+{
+  uint32_t elapsed_ms = (micros() - power_stats.since_us) / 1000;
+  return elapsed_ms ? (uint32_t)power_stats.wakeups * 1000 / elapsed_ms : 0;
+}
+
+void PowerResetStats()
+{
+  power_stats = PowerStats{(uint32_t)micros(), 0, 0};
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Platform.h"
+
+/*=========================================================================
+    POWER SAVE
+
+    loop() used to spin through SchedulerRun() even when nothing was due.
+    IdleSleep() puts the CPU in idle sleep until the next task is due
+    instead, or until an interrupt: the ADC in audio mode, the Bluefruit
+    raising its IRQ line, USB.  Timers, SPI and the ADC keep running in
+    idle sleep, only the CPU clock stops, so nothing that runs from a
+    task notices.
+
+    Left alone, the timer0 overflow behind millis() would wake the CPU
+    every 2.048 ms (1.024 ms at 16 MHz).  While asleep its interrupt is
+    masked and timer3, counting from the same clk/64 prescaler, wakes
+    the CPU at the overflow that takes millis() to the next task's wake
+    time.  The overflows slept through are then added to millis() and
+    micros() in one go, so neither loses time.  Timer3 is not available
+    for anything else.
+
+    power_stats counts how long the CPU slept and every wakeup from it,
+    whatever the interrupt, for the stats printout.
+    -----------------------------------------------------------------------*/
+struct PowerStats
+{
+  uint32_t since_us; // micros() when the stats were reset
+  uint32_t sleep_us; // time spent asleep since then
+  uint32_t wakeups;  // returns from sleep
+};
+
+extern PowerStats power_stats;
+
+// Sleep until the next task is due or an interrupt comes.  Returns at once
+// if a task is due already or *pending (set by an ISR) is, which is checked
+// with interrupts off so an ISR setting it cannot be missed.
+void IdleSleep(const volatile bool *pending = nullptr);
+
+// Percent of the time since the last reset the CPU was awake
+uint8_t PowerDutyCycle();
+// Wakeups per second since the last reset
+uint16_t PowerWakeupRate();
+void PowerResetStats();
@@ -0,0 +1,186 @@
+#include "Scheduler.h"
+
+SchedulerStats scheduler_stats;
+
+static Task *run_queue{nullptr};
+static Task *due_list{nullptr}; // taken off run_queue by SchedulerRun(), not run yet
+
+// wrap-safe "a is before b" for millis() timestamps
+static inline bool Before(uint32_t a, uint32_t b)
+{
+  return (int32_t)(a - b) < 0;
+}
+
+static void Enqueue(Task &task)
+{
+  Task **link = &run_queue;
+  // tasks due at the same time run in the order they were queued
+  while (*link && !Before(task.wake_time, (*link)->wake_time))
+  {
+    link = &(*link)->next;
+  }
+  task.next = *link;
+  *link = &task;
+  task.queued = true;
+}
+
+static bool Unlink(Task **list, Task &task)
+{
+  for (Task **link = list; *link; link = &(*link)->next)
+  {
+    if (*link == &task)
+    {
+      *link = task.next;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void Dequeue(Task &task)
+{
+  if (!Unlink(&run_queue, task))
+  {
+    Unlink(&due_list, task);
+  }
+  task.next = nullptr;
+  task.queued = false;
+}
+
+void TaskStart(Task &task, TaskFunction run, void *state, uint32_t delay_ms)
+{
+  if (task.queued)
+  {
+    Dequeue(task);
+  }
+  task.run = run;
+  task.state = state;
+  task.resume = 0;
+  task.wake_time = millis() + delay_ms;
+  Enqueue(task);
+}
+
+void TaskSuspend(Task &task)
+{
+  task.slept = false;
+  if (task.queued)
+  {
+    Dequeue(task);
+  }
+}
+
+void TaskResume(Task &task)
+{
+  if (!task.queued && task.run)
+  {
+    task.wake_time = millis();
+    Enqueue(task);
+  }
+}
+
+void TaskWake(Task &task)
+{
+  if (task.queued)
+  {
+    Dequeue(task);
+    task.wake_time = millis();
+    Enqueue(task);
+  }
+}
+
+bool TaskRunning(const Task &task)
+{
+  return task.queued;
+}
+
+void TaskSetSleep(Task &task, uint32_t ms)
+{
+  uint32_t now = millis();
+  // same catch-up rule the color wipes used: stay on the grid unless more than a period behind
+  if (now - task.wake_time <= ms)
+  {
+    task.wake_time += ms;
+  }
+  else
+  {
+    task.wake_time = now + ms;
+  }
+  task.slept = true;
+}
+
+void TaskSetDelay(Task &task, uint32_t ms)
+{
+  task.wake_time = millis() + ms;
+  task.slept = true;
+}
+
+uint8_t SchedulerRun()
+{
+  uint8_t ran = 0;
+#if SCHEDULER_STATS
+  uint32_t start = micros();
+  uint32_t busy = 0;
+#endif
+  // take everything that is due now off the queue first, so a task that
+  // yields runs once per SchedulerRun() instead of starving loop()
+  uint32_t now = millis();
+  Task **due_tail = &due_list;
+  while (run_queue && !Before(now, run_queue->wake_time))
+  {
+    *due_tail = run_queue;
+    due_tail = &run_queue->next;
+    run_queue = run_queue->next;
+  }
+  *due_tail = nullptr;
+
+  while (due_list)
+  {
+    Task &task = *due_list;
+    due_list = task.next;
+    task.next = nullptr;
+    task.queued = false;
+
+    uint32_t late = millis() - task.wake_time;
+    if (late > scheduler_stats.max_late_ms)
+    {
+      scheduler_stats.max_late_ms = late > 0xffff ? 0xffff : late;
+    }
+
+    task.slept = false;
+#if SCHEDULER_STATS
+    uint32_t body_start = micros();
+#endif
+    task.run(task);
+#if SCHEDULER_STATS
+    busy += micros() - body_start;
+#endif
+    scheduler_stats.dispatches++;
+    ran++;
+
+    // the task may have restarted or suspended itself from inside run()
+    if (task.slept && !task.queued)
+    {
+      Enqueue(task);
+    }
+  }
+#if SCHEDULER_STATS
+  scheduler_stats.busy_us += busy;
+  scheduler_stats.overhead_us += (micros() - start) - busy;
+#endif
+  return ran;
+}
+
+uint32_t SchedulerIdleTime()
+{
+  if (!run_queue)
+  {
+    return SCHEDULER_IDLE;
+  }
+  uint32_t now = millis();
+  return Before(now, run_queue->wake_time) ? run_queue->wake_time - now : 0;
+}
+
+void SchedulerResetStats()
+{
+  scheduler_stats = SchedulerStats{};
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Platform.h"
+
+/*=========================================================================
+    COOPERATIVE SCHEDULER
+
+    Replaces the Start/Process function pairs that kept their progress in
+    file-scope globals.  A task is a function plus a state struct of its
+    own, written as a stackless coroutine (protothread):
+
+      struct BlinkState { uint8_t count; };
+
+      void BlinkTask(Task &task)
+      {
+        BlinkState &s = *static_cast<BlinkState *>(task.state);
+        TASK_BEGIN(task);
+        for (s.count = 0; s.count < 10; s.count++)
+        {
+          ...
+          TASK_SLEEP(task, 100);
+        }
+        TASK_END(task);
+      }
+
+    The function returns at every TASK_SLEEP/TASK_YIELD and continues right
+    after it the next time it runs.  Local variables do not survive a
+    sleep, keep anything that must in the state struct, and do not put a
+    TASK_SLEEP inside a switch statement.
+
+    Sleeping tasks sit in a run queue ordered by wake time.  SchedulerRun()
+    runs every task that is due, so several timed activities interleave and
+    each one waits at most as long as the longest slice of the others.
+    -----------------------------------------------------------------------*/
+
+// Set to 0 to drop the overhead bookkeeping (three micros() calls per dispatch)
+#ifndef SCHEDULER_STATS
+#define SCHEDULER_STATS 1
+#endif
+
+struct Task;
+typedef void (*TaskFunction)(Task &task);
+
+struct Task
+{
+  TaskFunction run;
+  void *state;        // the task's own state struct
+  uint32_t wake_time; // millis() at which the task runs next
+  uint16_t resume;    // where the coroutine continues, 0 = from the top
+  bool slept;         // set by TASK_SLEEP/TASK_YIELD, a task that returns without it is finished
+  bool queued;
+  Task *next;         // run queue link
+};
+
+struct SchedulerStats
+{
+  uint32_t dispatches;  // task slices run
+  uint32_t overhead_us; // time spent in the scheduler itself, task bodies excluded
+  uint32_t busy_us;     // time spent in task bodies
+  uint16_t max_late_ms; // worst delay between a wake time and the slice actually running
+};
+
+extern SchedulerStats scheduler_stats;
+
+// (Re)start task from the top with the given state, first run at millis() + delay_ms
+void TaskStart(Task &task, TaskFunction run, void *state, uint32_t delay_ms = 0);
+// Take task off the run queue, its state and position are kept
+void TaskSuspend(Task &task);
+// Put a suspended task back on the run queue, due now
+void TaskResume(Task &task);
+// Run a sleeping task now instead of at its wake time
+void TaskWake(Task &task);
+bool TaskRunning(const Task &task);
+
+// Run every task whose wake time has come; call as often as possible from loop().
+// Returns how many task slices ran, 0 if nothing was due.
+uint8_t SchedulerRun();
+// Milliseconds until the earliest wake time, 0 if something is due, SCHEDULER_IDLE if no task is queued
+#define SCHEDULER_IDLE 0xFFFFFFFFUL
+uint32_t SchedulerIdleTime();
+void SchedulerResetStats();
+
+// Used by TASK_SLEEP: next wake is ms after the previous one, unless the task fell behind
+void TaskSetSleep(Task &task, uint32_t ms);
+// Used by TASK_DELAY: next wake is ms from now, for tasks that keep their own time grid
+void TaskSetDelay(Task &task, uint32_t ms);
+
+#define TASK_BEGIN(task) \
+  switch ((task).resume) \
+  {                      \
+  case 0:
+
+#define TASK_SLEEP(task, ms)      \
+  do                              \
+  {                               \
+    (task).resume = __LINE__;     \
+    TaskSetSleep((task), (ms));   \
+    return;                       \
+  case __LINE__:;                 \
+  } while (0)
+
+#define TASK_DELAY(task, ms)      \
+  do                              \
+  {                               \
+    (task).resume = __LINE__;     \
+    TaskSetDelay((task), (ms));   \
+    return;                       \
+  case __LINE__:;                 \
+  } while (0)
+
+#define TASK_YIELD(task) TASK_SLEEP(task, 0)
+
+#define TASK_END(task) \
+  }                    \
+  (task).resume = 0
@@ -0,0 +1,209 @@
+#include "Sync.h"
+#include "Animation.h"
+#include "Effects.h"
+
+bool sync_master{false};
+
+static bool locked{false};
+static uint32_t sync_local;  // local time of the last correction
+static uint32_t sync_remote; // master time at sync_local
+static int32_t drift_q20;    // master ms gained per local ms, 2^20 = 100%
+
+// The drift is measured between the least delayed packets of successive
+// windows of this many sync intervals
+static const uint8_t kDriftWindow = 16;
+static uint32_t window_start; // local time the current window began
+static int32_t window_best;   // largest master - local offset seen in it
+static int32_t previous_best;
+static bool have_previous;
+static uint8_t late_packets; // since the estimate last moved forward
+
+// Without a packet that moves the estimate forward, it slides back 1 ms every
+// this many packets, for drift the window measurement has not caught yet
+static const uint8_t kLeakEvery = 4;
+
+// drift is clamped to +-3%, far more than any crystal or resonator is off
+static const int32_t kMaxDrift = (int32_t)1 << 15;
+
+// Master time at local time `local`, extrapolated from the last correction
+static uint32_t ToMaster(uint32_t local)
+{
+  uint32_t elapsed = local - sync_local;
+  if (elapsed > 0xffff)
+  {
+    elapsed = 0xffff; // keeps the product below 2^31, and syncs are much more frequent
+  }
+  return sync_remote + (local - sync_local) + (((int32_t)elapsed * drift_q20) >> 20);
+}
+
+uint32_t AnimationTime()
+{
+  uint32_t now = millis();
+  return locked ? ToMaster(now) : now;
+}
+
+// Track the master - local offset of the least delayed packet per window,
+// the drift is how much that moves from one window to the next
+static void MeasureDrift(uint32_t now, int32_t offset)
+{
+  if (offset > window_best)
+  {
+    window_best = offset;
+  }
+  uint32_t length = now - window_start;
+  if (length < (uint32_t)kDriftWindow * SYNC_INTERVAL)
+  {
+    return;
+  }
+  int32_t moved = window_best - previous_best;
+  if (have_previous && length < 0xffff && moved > -SYNC_RELOCK_MS && moved < SYNC_RELOCK_MS)
+  {
+    drift_q20 = (moved << 20) / (int32_t)length;
+    if (drift_q20 > kMaxDrift)
+      drift_q20 = kMaxDrift;
+    if (drift_q20 < -kMaxDrift)
+      drift_q20 = -kMaxDrift;
+  }
+  previous_best = window_best;
+  have_previous = true;
+  window_start = now;
+  window_best = INT32_MIN;
+}
+
+void SyncObserve(uint32_t master_now)
+{
+  uint32_t now = millis();
+  int32_t offset = (int32_t)(master_now - now);
+  if (!locked)
+  {
+    locked = true;
+    sync_local = now;
+    sync_remote = master_now;
+    drift_q20 = 0;
+    window_start = now;
+    window_best = offset;
+    have_previous = false;
+    return;
+  }
+
+  uint32_t predicted = ToMaster(now);
+  int32_t error = (int32_t)(master_now - predicted);
+  if (error > SYNC_RELOCK_MS || error < -SYNC_RELOCK_MS)
+  {
+    locked = false; // master restarted or we missed a lot, start over
+    SyncObserve(master_now);
+    return;
+  }
+  MeasureDrift(now, offset);
+
+  // A packet can only arrive late, never early, so the one that makes the
+  // master look furthest ahead is the best estimate: take it at once.  The
+  // others only let the estimate slide back slowly, so the clock does not
+  // follow the link jitter.
+  if (error > 0)
+  {
+    sync_remote = master_now;
+    late_packets = 0;
+  }
+  else
+  {
+    sync_remote = ++late_packets % kLeakEvery == 0 ? predicted - 1 : predicted;
+  }
+  sync_local = now;
+}
+
+void SyncReset()
+{
+  locked = false;
+}
+
+bool SyncLocked()
+{
+  return locked;
+}
+
+int32_t SyncDrift()
+{
+  return drift_q20;
+}
+
+// Sync packet states besides a running Mode (see Sync.h)
+static const uint8_t kSyncBusy = 8;
+static const uint8_t kSyncPaused = 8;
+static const uint32_t kSyncLit = 0x01000000;
+
+void BuildSyncPacket(uint8_t *buf)
+{
+  uint8_t state;
+  uint32_t value;
+  if (current_mode == Mode::Static && previous_mode == Mode::Static)
+  {
+    state = (uint8_t)Mode::Static;
+    value = BladeDark() ? 0 : kSyncLit | ((uint32_t)red << 16) | ((uint32_t)green << 8) | blue;
+  }
+  else if (current_mode == Mode::Static && previous_mode <= Mode::Flicker)
+  {
+    state = kSyncPaused + (uint8_t)previous_mode;
+    value = PausedElapsed();
+  }
+  else if (current_mode == Mode::Static)
+  {
+    // paused igniting or retracting, which receivers do not follow either
+    state = kSyncBusy;
+    value = 0;
+  }
+  else if (current_mode <= Mode::Flicker)
+  {
+    state = (uint8_t)current_mode;
+    value = animation_start;
+  }
+  else
+  {
+    state = kSyncBusy;
+    value = 0;
+  }
+
+  buf[0] = '!';
+  buf[1] = 'S';
+  PutHex(buf + 2, state, 1);
+  PutHex(buf + 3, value, 8);
+  PutHex(buf + 11, AnimationTime(), 8);
+
+  uint8_t xsum = 0;
+  for (uint8_t i = 0; i < PACKET_SYNC_LEN - 1; i++)
+  {
+    xsum += buf[i];
+  }
+  buf[PACKET_SYNC_LEN - 1] = ~xsum;
+}
+
+bool HandleSyncPacket(const uint8_t *packet)
+{
+  uint32_t state, value, now;
+  if (packet[0] != '!' || packet[1] != 'S')
+  {
+    return false;
+  }
+  if (!GetHex(packet + 2, 1, &state) || !GetHex(packet + 3, 8, &value) || !GetHex(packet + 11, 8, &now))
+  {
+    return false;
+  }
+  if (sync_master)
+  {
+    return true;
+  }
+  SyncObserve(now + SYNC_LINK_DELAY);
+  if (state == (uint8_t)Mode::Static)
+  {
+    SyncStaticColor(value & kSyncLit, value >> 16, value >> 8, value);
+  }
+  else if (state < kSyncBusy)
+  {
+    SyncAnimation((Mode)state, value);
+  }
+  else if (state > kSyncPaused)
+  {
+    SyncPausedAnimation((Mode)(state - kSyncPaused), value);
+  }
+  return true;
+}
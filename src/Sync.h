@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Platform.h"
+#include "PacketStream.h"
+
+/*=========================================================================
+    SYNC
+
+    Keeps several swords rendering the same frame at the same time.
+
+    One sword (or the phone) is the master and broadcasts sync packets with
+    its clock, the current mode and the master time at which that mode's
+    animation started.  Every other sword estimates the offset of its own
+    millis() from the least delayed packets and the drift from how that
+    offset moves over a few sync intervals, and runs its animation off
+    AnimationTime() instead of millis().
+    Animations that compute their frame from AnimationTime() - start then
+    show the same frame as the master.
+
+    The swords do not talk to each other directly.  The master writes its
+    packets to the BLE UART, and something has to relay them to the UART
+    of every other sword: a BLE central connected to all of them that
+    forwards what the master's TX characteristic notifies.  This project
+    does not ship that relay, and the stock Bluefruit LE Connect app does
+    not do it (it talks to one sword at a time), so as shipped sync only
+    works with a custom relay.  A sync packet is written in the
+    Controller protocol style with the numbers as hex, so the payload can
+    never contain a '!':
+      '!' 'S' <state 1 hex digit> <value 8 hex digits> <now 8 hex digits> <checksum>
+    (PACKET_SYNC_LEN bytes, see PacketStream.h), where state and value are
+      0        Mode::Static, value 0 for a dark blade or 0x01RRGGBB for a color
+      1 - 7    that Mode running, value the master time it started at
+      9 - 15   Mode state - 8 paused, value the ms into it it was paused at
+      8        the blade igniting or retracting (or paused doing so),
+               nothing to follow
+    so a paused master freezes its receivers on the same frame and a
+    static color shows on every blade.
+
+    SYNC_INTERVAL             Time in ms between sync packets sent by the master
+    SYNC_RELOCK_MS            A clock error larger than this restarts the lock
+    SYNC_LINK_DELAY           About the shortest ms from the master writing a
+                              sync packet to us reading it, added to its
+                              timestamp
+    -----------------------------------------------------------------------*/
+#define SYNC_INTERVAL 1000
+#define SYNC_RELOCK_MS 200
+#define SYNC_LINK_DELAY 12
+
+// Set on the sword that sends the sync packets, it ignores any it receives
+extern bool sync_master;
+
+// The master's clock when locked, our own millis() otherwise
+uint32_t AnimationTime();
+
+// Feed one master timestamp, received at local time millis()
+void SyncObserve(uint32_t master_now);
+
+// Forget the lock and run free again
+void SyncReset();
+bool SyncLocked();
+
+// Estimated master ms gained per local ms, in parts per 2^20 (2^20 = 100%)
+int32_t SyncDrift();
+
+// Fill buf with a PACKET_SYNC_LEN byte sync packet for the current animation
+void BuildSyncPacket(uint8_t *buf);
+
+// Lock onto the clock and follow the animation of a received sync packet,
+// false if it is malformed
+bool HandleSyncPacket(const uint8_t *packet);
@@ -0,0 +1,444 @@
+/*********************************************************************
+ Cycle counts of the blade code on the sword's own CPU.
+
+ Built for the feather32u4 by the "avrbench" environment instead of the
+ controller firmware, and meant to run under simavr:
+
+   pio run -e avrbench -t simavr
+
+ (or by hand: run_avr -m atmega32u4 -f 8000000 firmware.elf).  It also
+ runs on a real Feather 32u4, the report then goes out of TX (Serial1).
+
+ Every kernel runs once per measurement with Timer1 counting CPU cycles
+ at prescaler 1.  Serial1 is drained before each kernel and the millis()
+ tick and the USB device interrupts are masked while measuring, so the
+ only interrupt left is the Timer1 overflow that extends the counter to
+ 32 bits; it adds under 0.05% to kernels longer than 65536 cycles.
+ Before each kernel the free RAM from the heap start up to the stack
+ pointer is filled with a pattern, and the deepest byte overwritten
+ afterwards gives the kernel's stack use.
+
+ Last, it sleeps through IdleSleep() for a few seconds and reports how
+ far millis() got from the time Timer1 counted meanwhile.
+*********************************************************************/
+
+#include <Arduino.h>
+#include <avr/sleep.h>
+
+#include "../BladeConfig.h"
+#include "../BluefruitConfig.h"
+#include "../BladeOutput.h"
+#include "../Effects.h"
+#include "../NoiseEffects.h"
+#include "../AudioReactive.h"
+#include "../PacketStream.h"
+#include "../Modulation.h"
+#include "../PowerSave.h"
+#include "../Ignition.h"
+#include "../Scheduler.h"
+#include "../Sync.h"
+
+BladeOutput pixel;
+
+/*=========================================================================
+    CYCLE COUNTER
+    -----------------------------------------------------------------------*/
+static volatile uint16_t cycles_high;
+
+ISR(TIMER1_OVF_vect)
+{
+  cycles_high++;
+}
+
+static void StartCycleCounter()
+{
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10); // clk/1
+  TCNT1 = 0;
+  TIFR1 = _BV(TOV1);
+  TIMSK1 = _BV(TOIE1);
+}
+
+static uint32_t Cycles()
+{
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t low = TCNT1;
+  uint16_t high = cycles_high;
+  // an overflow that happened after cli() is still pending
+  if ((TIFR1 & _BV(TOV1)) && low < 0x8000)
+  {
+    high++;
+  }
+  SREG = sreg;
+  return ((uint32_t)high << 16) | low;
+}
+
+/*=========================================================================
+    STACK HIGH-WATER MARK
+    -----------------------------------------------------------------------*/
+extern uint8_t __heap_start;
+static const uint8_t kStackPaint = 0xa5;
+
+// Fill the free RAM between the heap start and the current stack pointer.
+// Inlined so that "current" is the caller's frame, not a frame of its own;
+// the caller keeps interrupts off so no ISR frame lands in the paint.
+static inline __attribute__((always_inline)) uint8_t *PaintStack()
+{
+  uint8_t *top = (uint8_t *)SP; // SP points at the next free byte
+  for (uint8_t *p = &__heap_start; p <= top; p++)
+  {
+    *p = kStackPaint;
+  }
+  return top;
+}
+
+// Lowest address a kernel wrote below the stack since PaintStack()
+static uint8_t *StackLow()
+{
+  uint8_t *p = &__heap_start;
+  while (*p == kStackPaint)
+  {
+    p++;
+  }
+  return p;
+}
+
+/*=========================================================================
+    MEASUREMENT
+    -----------------------------------------------------------------------*/
+struct Result
+{
+  uint32_t cycles;
+  uint16_t stack; // bytes below the caller's stack pointer
+};
+
+static uint32_t call_overhead;
+
+static Result Measure(void (*kernel)())
+{
+  Serial1.flush(); // waits for TXC, so no UDRE interrupt fires in the kernel
+  uint8_t timsk0 = TIMSK0;
+  uint8_t udien = UDIEN;
+  cli();
+  uint8_t *base = PaintStack();
+  TIMSK0 = timsk0 & ~_BV(TOIE0); // no millis() tick while measuring
+  UDIEN = 0;                     // nor the USB start-of-frame every 1 ms
+  sei();
+  uint32_t c0 = Cycles();
+  kernel();
+  uint32_t c1 = Cycles();
+  TIMSK0 = timsk0;
+  UDIEN = udien;
+  uint8_t *low = StackLow();
+  return Result{c1 - c0 - call_overhead, (uint16_t)(low <= base ? base - low + 1 : 0)};
+}
+
+// How often a kernel of r.cycles could run back to back
+static void PrintRate(const __FlashStringHelper *name, const Result &r)
+{
+  Serial1.print(name);
+  Serial1.print('\t');
+  Serial1.print(r.cycles ? (float)F_CPU / r.cycles : 0.0f, 1);
+  Serial1.println(F(" /s"));
+}
+
+static void Print(const __FlashStringHelper *name, const Result &r, uint16_t per, const __FlashStringHelper *unit)
+{
+  Serial1.print(name);
+  Serial1.print('\t');
+  Serial1.print(r.cycles);
+  Serial1.print(F(" cycles\t"));
+  Serial1.print((float)r.cycles * 1e6f / F_CPU, 1);
+  Serial1.print(F(" us\t"));
+  if (per)
+  {
+    Serial1.print((float)r.cycles / per, 1);
+    Serial1.print(F(" cycles/"));
+    Serial1.print(unit);
+    Serial1.print('\t');
+  }
+  Serial1.print(r.stack);
+  Serial1.println(F(" B stack"));
+}
+
+/*=========================================================================
+    EFFECT KERNELS, one frame each
+    -----------------------------------------------------------------------*/
+static uint16_t bench_t;
+static volatile uint8_t runtime_value = 100; // keeps Color() from folding to a constant
+
+static void Empty() {}
+
+static void BenchColor()
+{
+  for (uint16_t i = 0; i < NUMPIXELS; i++)
+  {
+    pixel.setPixelColor(i, pixel.Color(runtime_value, i, bench_t));
+  }
+}
+
+static void BenchWheel()
+{
+  for (uint16_t i = 0; i < NUMPIXELS; i++)
+  {
+    pixel.setPixelColor(i, Wheel(i + bench_t));
+  }
+}
+
+static void BenchNoise8()
+{
+  for (uint16_t i = 0; i < NUMPIXELS; i++)
+  {
+    pixel.setPixelColor(i, Noise8(i << 6, bench_t));
+  }
+}
+
+static void BenchFire() { RenderFire(); }
+static void BenchPlasma() { RenderPlasma(bench_t); }
+static void BenchFlicker() { RenderFlicker(bench_t); }
+// mid ignition, overshooting: edge pixel and flash both active
+static void BenchIgnition() { RenderBladeLength(EaseAt(Ease::Overshoot, 20000)); }
+static void BenchShow() { pixel.show(); }
+
+/*=========================================================================
+    TIME AND SCHEDULER
+    -----------------------------------------------------------------------*/
+static volatile uint32_t sink32;
+static Task idle_tasks[8];
+
+static void IdleTask(Task &task)
+{
+  TASK_BEGIN(task);
+  for (;;)
+  {
+    TASK_SLEEP(task, 100);
+  }
+  TASK_END(task);
+}
+
+// Long sleeps through IdleSleep(), which adds the timer0 overflows it slept
+// through to millis().  Timer1 keeps counting in idle sleep, so it gives
+// the true time: at clk/1024 and with its interrupt off it does not wake
+// the CPU and covers kSleepSpanMs in 16 bits at up to 16 MHz.
+static const uint16_t kSleepSpanMs = 4000;
+
+static void SleepTask(Task &task)
+{
+  TASK_BEGIN(task);
+  for (;;)
+  {
+    TASK_SLEEP(task, 1000);
+  }
+  TASK_END(task);
+}
+
+static void MeasureSleepDrift()
+{
+  Serial1.flush();
+  uint8_t udien = UDIEN;
+  UDIEN = 0;
+  TaskStart(idle_tasks[0], SleepTask, nullptr);
+  TIMSK1 = 0;
+  TCCR1B = _BV(CS12) | _BV(CS10);
+  PowerResetStats();
+  noInterrupts();
+  uint16_t c0 = TCNT1;
+  uint32_t m0 = millis();
+  interrupts();
+  uint32_t m1;
+  while ((m1 = millis()) - m0 < kSleepSpanMs)
+  {
+    SchedulerRun();
+    IdleSleep();
+  }
+  uint16_t c1 = TCNT1;
+  uint32_t wakeups = power_stats.wakeups;
+  TaskSuspend(idle_tasks[0]);
+  StartCycleCounter();
+  UDIEN = udien;
+
+  uint32_t true_ms = (uint32_t)(uint16_t)(c1 - c0) * 1024 / (F_CPU / 1000);
+  Serial1.print(F("sleep drift\t"));
+  Serial1.print(m1 - m0);
+  Serial1.print(F(" ms millis()\t"));
+  Serial1.print(true_ms);
+  Serial1.print(F(" ms timer1\t"));
+  Serial1.print((long)(m1 - m0) - (long)true_ms);
+  Serial1.print(F(" ms drift\t"));
+  Serial1.print(wakeups);
+  Serial1.println(F(" wakeups"));
+}
+
+static void BenchMillis() { sink32 = millis(); }
+static void BenchAnimationTime() { sink32 = AnimationTime(); }
+static void BenchScheduler() { SchedulerRun(); }
+
+/*=========================================================================
+    AUDIO PIPELINE
+    -----------------------------------------------------------------------*/
+static Task audio_task;
+static void BenchAudioSlice() { AudioReactiveTask(audio_task); }
+
+/*=========================================================================
+    PACKET PARSER, the readPacket() path with an in-memory module
+    -----------------------------------------------------------------------*/
+struct MemoryStream
+{
+  const uint8_t *data;
+  uint8_t len;
+  uint8_t pos;
+  int available() { return len - pos; }
+  int read() { return data[pos++]; }
+};
+
+static RxRing bench_ring;
+static MemoryStream bench_stream;
+static uint8_t packet[PACKET_SYNC_LEN];
+static volatile uint8_t parsed;
+
+static void BenchParse()
+{
+  bench_stream.pos = 0;
+  RxFill(bench_ring, bench_stream);
+  while (uint8_t len = ParsePacket(bench_ring, BLE_READPACKET_TIMEOUT))
+  {
+    parsed = len;
+  }
+}
+
+static void SetPacket(const char *head, uint8_t len)
+{
+  uint8_t xsum = 0;
+  for (uint8_t i = 0; i < len - 1; i++)
+  {
+    packet[i] = head[i];
+    xsum += packet[i];
+  }
+  packet[len - 1] = ~xsum;
+  bench_stream = MemoryStream{packet, len, 0};
+}
+
+/*=========================================================================
+    REPORT
+    -----------------------------------------------------------------------*/
+static void RunBench()
+{
+  Serial1.print(F("F_CPU "));
+  Serial1.print(F_CPU);
+  Serial1.print(F(", "));
+  Serial1.print(NUMPIXELS);
+  Serial1.println(F(" pixels per strip"));
+
+  call_overhead = 0;
+  call_overhead = Measure(Empty).cycles;
+
+  pixel.begin();
+  StartNoiseEffect();
+  bench_t = 1234;
+  Print(F("color"), Measure(BenchColor), NUMPIXELS, F("px"));
+  Print(F("wheel"), Measure(BenchWheel), NUMPIXELS, F("px"));
+  Print(F("noise8"), Measure(BenchNoise8), NUMPIXELS, F("px"));
+  Print(F("fire"), Measure(BenchFire), 2 * NUMPIXELS, F("px"));
+  Print(F("plasma"), Measure(BenchPlasma), 2 * NUMPIXELS, F("px"));
+  Print(F("flicker"), Measure(BenchFlicker), 2 * NUMPIXELS, F("px"));
+  Print(F("ignition"), Measure(BenchIgnition), NUMPIXELS, F("px"));
+  // the renders above changed the pixels, so the first show() sends them
+  Result show = Measure(BenchShow);
+  Print(F("show"), show, 2 * NUMPIXELS, F("px"));
+  PrintRate(F("max show rate"), show);
+  Print(F("show unchanged"), Measure(BenchShow), 0, nullptr);
+  // the dithering budget: every show() while the blade is between levels
+  pixel.setBrightness(24);
+  BenchPlasma();
+  pixel.show();
+  Result dithered = Measure(BenchShow);
+  Print(F("show dithered"), dithered, 2 * NUMPIXELS, F("px"));
+  PrintRate(F("max dithered rate"), dithered);
+  pixel.setBrightness(255);
+
+  Print(F("millis"), Measure(BenchMillis), 0, nullptr);
+  SyncObserve(millis() + 5000);
+  Print(F("AnimationTime"), Measure(BenchAnimationTime), 0, nullptr);
+  SyncReset();
+  for (Task &t : idle_tasks)
+  {
+    TaskStart(t, IdleTask, nullptr, 10000);
+  }
+  Print(F("sched idle"), Measure(BenchScheduler), 0, nullptr);
+  TaskWake(idle_tasks[7]);
+  Print(F("sched dispatch"), Measure(BenchScheduler), 0, nullptr);
+  for (Task &t : idle_tasks)
+  {
+    TaskSuspend(t);
+  }
+
+  // feed one FFT worth of a test tone without the ADC running; timer0 is
+  // stopped so millis() stands still and no AUDIO_FRAME_MS render (and its
+  // show()) falls into a slice, only the FFT is timed
+  uint8_t tccr0b = TCCR0B;
+  TCCR0B = 0;
+  StartAudioReactive();
+  StopAudioReactive();
+  for (uint8_t i = 0; i < AUDIO_FFT_SIZE; i++)
+  {
+    AudioPushSample(512 + ((i & 4) ? 200 : -200));
+  }
+  audio_task = Task{};
+  Result total{0, 0};
+  Result worst{0, 0};
+  // the first slice notices the samples, then load, the stages and the band sums
+  for (uint8_t s = 0; s < AUDIO_FFT_LOG2 + 3; s++)
+  {
+    Result r = Measure(BenchAudioSlice);
+    total.cycles += r.cycles;
+    total.stack = max(total.stack, r.stack);
+    if (r.cycles > worst.cycles)
+    {
+      worst = r;
+    }
+  }
+  TCCR0B = tccr0b;
+  Print(F("fft total"), total, AUDIO_FFT_LOG2 + 3, F("slice"));
+  Print(F("fft worst slice"), worst, 0, nullptr);
+
+  ResetPacketParser();
+  SetPacket("!B21", PACKET_BUTTON_LEN);
+  Print(F("parse button"), Measure(BenchParse), PACKET_BUTTON_LEN, F("byte"));
+  SetPacket("!C\x20\x40\x60", PACKET_COLOR_LEN);
+  Print(F("parse color"), Measure(BenchParse), PACKET_COLOR_LEN, F("byte"));
+  BuildSyncPacket(packet);
+  bench_stream = MemoryStream{packet, PACKET_SYNC_LEN, 0};
+  Print(F("parse sync"), Measure(BenchParse), PACKET_SYNC_LEN, F("byte"));
+  HandleSyncPacket(packetbuffer); // lock first, the steady state is what counts
+  Print(F("handle sync"), Measure([] { HandleSyncPacket(packetbuffer); }), 0, nullptr);
+
+  // every slot busy, one of each kind of source
+  ModulationBind(0, ModShape::Sine, ModTarget::Brightness, 40, 255, 1500);
+  ModulationBind(1, ModShape::Triangle, ModTarget::Hue, 0, 255, 4000);
+  ModulationBind(2, ModShape::Saw, ModTarget::Speed, 64, 192, 2500);
+  ModulationBind(3, ModShape::Envelope, ModTarget::FireCooling, 20, 100, 0);
+  ModulationGate(true);
+  Print(F("modulation"), Measure([] { ModulationUpdate(); }), MOD_SLOTS, F("slot"));
+  ModulationReset();
+
+  MeasureSleepDrift();
+
+  Serial1.println(F("done"));
+  Serial1.flush();
+}
+
+void setup()
+{
+  Serial1.begin(115200);
+  StartCycleCounter();
+  RunBench();
+  // simavr exits when the CPU sleeps with interrupts off
+  cli();
+  sleep_enable();
+  sleep_cpu();
+}
+
+void loop()
+{
+}
@@ -26,6 +26,15 @@
 #include "BluefruitConfig.h"
 
 #include <Adafruit_NeoPixel.h>
+#include "BladeConfig.h"
+#include "BladeOutput.h"
+#include "Effects.h"
+#include "Animation.h"
+#include "Scheduler.h"
+#include "Sync.h"
+#include "PowerSave.h"
+#include "Modulation.h"
+#include "Ignition.h"
 
 /*=========================================================================
     APPLICATION SETTINGS
@@ -53,64 +62,14 @@
                               since the factory reset will clear all of the
                               bonding data stored on the chip, meaning the
                               central device won't be able to reconnect.
-    PIN                       Which pin on the Arduino is connected to the NeoPixels?
-    NUMPIXELS                 How many NeoPixels are attached to the Arduino?
+    STATS_INTERVAL            How often (in ms) scheduler and power statistics
+                              are printed
     -----------------------------------------------------------------------*/
 #define FACTORYRESET_ENABLE 1
-
-#define PIN 6
-#define NUMPIXELS 53
+#define STATS_INTERVAL 10000
 /*=========================================================================*/
 
-class DualNeopixel : public Adafruit_NeoPixel
-{
-public:
-  DualNeopixel(uint16_t n, int16_t pin1, int16_t pin2) : p1{n, pin1}, p2{n, pin2} {}
-
-  void begin()
-  {
-    p1.begin();
-    p2.begin();
-  }
-
-  void setPixelColor(uint16_t n, uint32_t c)
-  {
-    p1.setPixelColor(n, c);
-    p2.setPixelColor(n, c);
-  }
-
-  void setPixelColor(bool pixel, uint16_t n, uint32_t c)
-  {
-    if (pixel)
-    {
-      p2.setPixelColor(n, c);
-    }
-    else
-    {
-      p1.setPixelColor(n, c);
-    }
-  }
-
-  void show()
-  {
-    p1.show();
-    p2.show();
-  }
-
-  void setBrightness(uint8_t b)
-  {
-    p1.setBrightness(b);
-    p2.setBrightness(b);
-  }
-
-  inline uint16_t numPixels() const { return p1.numPixels(); }
-
-private:
-  Adafruit_NeoPixel p1;
-  Adafruit_NeoPixel p2;
-};
-
-DualNeopixel pixel{NUMPIXELS, 6, 9}; // NeoPixel Object for Visor Strips
+BladeOutput pixel; // NeoPixel Object for Visor Strips
 // Adafruit_NeoPixel pixel = Adafruit_NeoPixel(NUMPIXELS, 6);
 
 // Create the bluefruit object, either software serial...uncomment these lines
@@ -145,20 +104,26 @@ uint8_t readPacket(Adafruit_BLE *ble, uint16_t timeout);
 float parsefloat(uint8_t *buffer);
 void printHex(const uint8_t *data, const uint32_t numBytes);
 
+// the packet buffer
+extern uint8_t packetbuffer[];
+
 // function prototypes of functions declared later
-void colorWipe(uint32_t c, uint8_t wait);
-void larsonScanner(uint32_t c, uint8_t wait);
-void theaterChase(uint32_t c, uint8_t wait);
-void rainbowCycle(uint8_t wait);
-uint32_t Wheel(byte WheelPos);
+void BleTask(Task &task);
+void StatsTask(Task &task);
+void SyncMasterTask(Task &task);
+void HandlePacket();
 
-void StartColorWipe(uint32_t c, uint8_t wait);
-void ProcessAnimationState();
-bool ProcessColorWipe();
-bool ProcessRotateColorWipe();
+Task ble_task;
+Task stats_task;
+Task sync_task;
 
-// the packet buffer
-extern uint8_t packetbuffer[];
+// set when the Bluefruit raises its IRQ line, so BleTask runs without waiting for its next poll
+volatile bool ble_irq{false};
+
+void BleIrq()
+{
+  ble_irq = true;
+}
 
 /**************************************************************************/
 /*!
@@ -168,14 +133,8 @@ extern uint8_t packetbuffer[];
 /**************************************************************************/
 // additional variables
 
-// Color
-uint8_t red = 255;
-uint8_t green = 255;
-uint8_t blue = 255;
 uint8_t animationState = 1;
 
-unsigned int pos = 0, dir = 1; // Position, direction of "eye" for larson scanner animation
-
 void setup(void)
 {
   // while (!Serial);  // required for Flora & Micro
@@ -243,446 +202,300 @@ void setup(void)
   ble.setMode(BLUEFRUIT_MODE_DATA);
 
   Serial.println(F("***********************"));
-}
 
-enum class Mode
-{
-  Static,
-  ColorWipes,
-  RotateColorWipes,
-  LarsonScanners //,
-                 // EtCetera
-};
-
-Mode current_mode{Mode::Static};
-Mode previous_mode{Mode::Static};
-
-uint8_t num_color_wipe_colors{8};
-uint32_t color_wipe_colors[] = {pixel.Color(114, 0, 255),
-                                pixel.Color(0, 0, 0),
-                                pixel.Color(0, 50, 255),
-                                pixel.Color(0, 0, 0),
-                                pixel.Color(0, 220, 255),
-                                pixel.Color(0, 0, 0),
-                                pixel.Color(255, 225, 255),
-                                pixel.Color(0, 0, 0)};
-
-uint32_t animation_loop_counter = 0;
+  attachInterrupt(digitalPinToInterrupt(BLUEFRUIT_SPI_IRQ), BleIrq, RISING);
+
+  TaskStart(ble_task, BleTask, nullptr);
+  TaskStart(stats_task, StatsTask, nullptr);
+  PowerResetStats();
+}
 
 /**************************************************************************/
 /*!
-    @brief  Constantly poll for new command or response data
+    @brief  Everything runs from scheduler tasks (see Scheduler.h), in
+            between the CPU sleeps (see PowerSave.h)
 */
 /**************************************************************************/
 void loop(void)
 {
-  ProcessAnimationState();
-
-  /* Wait for new data to arrive */
-  uint8_t len = readPacket(&ble, BLE_READPACKET_TIMEOUT);
-  if (len != 0)
+  SchedulerRun();
+  if (ble_irq)
   {
-
-    /* Got a packet! */
-    // printHex(packetbuffer, len);
-
-    // Color
-    if (packetbuffer[1] == 'C')
-    {
-      current_mode = Mode::Static;
-      uint8_t red = packetbuffer[2];
-      uint8_t green = packetbuffer[3];
-      uint8_t blue = packetbuffer[4];
-      Serial.print("RGB #");
-      if (red < 0x10)
-        Serial.print("0");
-      Serial.print(red, HEX);
-      if (green < 0x10)
-        Serial.print("0");
-      Serial.print(green, HEX);
-      if (blue < 0x10)
-        Serial.print("0");
-      Serial.println(blue, HEX);
-
-      for (uint8_t i = 0; i < NUMPIXELS; i++)
-      {
-        pixel.setPixelColor(i, pixel.Color(red, green, blue));
-      }
-      pixel.show(); // This sends the updated pixel color to the hardware.
-    }
-
-    // Buttons
-    if (packetbuffer[1] == 'B')
-    {
-
-      uint8_t buttnum = packetbuffer[2] - '0';
-      boolean pressed = packetbuffer[3] - '0';
-      Serial.print("Button ");
-      Serial.print(buttnum);
-      animationState = buttnum;
-      if (pressed)
-      {
-        Serial.println(" pressed");
-
-        /*  if (animationState == 1)
-         {
-           larsonScanner(pixel.Color(255, 255, 255), 20);
-           larsonScanner(pixel.Color(0, 255, 255), 20);
-           larsonScanner(pixel.Color(0, 100, 255), 20);
-           larsonScanner(pixel.Color(0, 50, 255), 20);
-           pixel.show(); // This sends the updated pixel color to the hardware.
-         } */
-
-        if (animationState == 2)
-        {
-          current_mode = Mode::ColorWipes;
-          animation_loop_counter = 0;
-          StartColorWipe(color_wipe_colors[animation_loop_counter], 30);
-        }
-
-        /* if (animationState == 3)
-        {
-          for (uint16_t i = 0; i < pixel.numPixels(); i++)
-          {
-            pixel.setPixelColor(i, pixel.Color(0, 0, 0));
-          }
-          pixel.setBrightness(255);
-          theaterChase(255, 30);
-          theaterChase(255, 40);
-          theaterChase(255, 50);
-          theaterChase(255, 60);
-          theaterChase(255, 70);
-          theaterChase(255, 80);
-          theaterChase(255, 90);
-          theaterChase(255, 100);
-          colorWipe(pixel.Color(0, 0, 255), 20);
-          colorWipe(pixel.Color(0, 0, 0), 20);
-          pixel.show(); // This sends the updated pixel color to the hardware.
-        }
-
-        if (animationState == 4)
-        {
-          for (uint16_t i = 0; i < pixel.numPixels(); i++)
-          {
-            pixel.setPixelColor(i, pixel.Color(0, 0, 0));
-          }
-          pixel.setBrightness(255);
-          rainbowCycle(10);
-          pixel.show(); // This sends the updated pixel color to the hardware.
-        } */
-
-        if (animationState == 6) // pause
-        {
-          if (current_mode != Mode::Static)
-          {
-            previous_mode = current_mode;
-            current_mode = Mode::Static;
-          }
-        }
-
-        if (animationState == 5) // resume
-        {
-          if (current_mode == Mode::Static)
-          {
-            current_mode = previous_mode;
-          }
-        }
-
-        if (animationState == 8)
-        {
-          current_mode = Mode::RotateColorWipes;
-          animation_loop_counter = 0;
-          StartColorWipe(color_wipe_colors[animation_loop_counter], 30);
-        }
-      }
-      else
-      {
-        Serial.println(" released");
-      }
-    }
+    ble_irq = false;
+    TaskWake(ble_task);
   }
+  // an IRQ from here on keeps IdleSleep() from sleeping, the next pass wakes BleTask
+  IdleSleep(&ble_irq);
 }
 
-void ProcessAnimationState()
+/**************************************************************************/
+/*!
+    @brief  Poll for new command data without blocking the animation
+*/
+/**************************************************************************/
+void BleTask(Task &task)
 {
-  switch (current_mode)
+  TASK_BEGIN(task);
+  for (;;)
   {
-  case Mode::ColorWipes:
-    if (ProcessColorWipe())
+    // handle everything that arrived since the last poll
+    for (;;)
     {
-      animation_loop_counter++;
-      if (animation_loop_counter >= num_color_wipe_colors)
+      uint8_t len = readPacket(&ble, BLE_READPACKET_TIMEOUT);
+      if (len == 0)
       {
-        animation_loop_counter = 0;
+        break;
       }
-      StartColorWipe(color_wipe_colors[animation_loop_counter], 30);
+      /* Got a packet! */
+      // printHex(packetbuffer, len);
+      HandlePacket();
     }
-    // do for other animations
-    break;
-  case Mode::RotateColorWipes:
-    if (ProcessRotateColorWipe())
-    {
-      animation_loop_counter++;
-      if (animation_loop_counter >= num_color_wipe_colors)
-      {
-        animation_loop_counter = 0;
-      }
-      StartColorWipe(color_wipe_colors[animation_loop_counter], 30);
-    }
-    break;
-  default:
-    break;
+    // the module also raises IRQ for the replies to our own reads
+    ble_irq = false;
+    // a static blade can wait a little longer for the next button
+    TASK_SLEEP(task, current_mode == Mode::Static ? BLE_IDLE_POLL_INTERVAL : BLE_POLL_INTERVAL);
   }
+  TASK_END(task);
 }
-// Fill the dots one after the other with a color
-
-uint32_t pixel_number{0};
-uint32_t last_frame_time;
-uint32_t wait_time;
-uint32_t color;
 
-void StartColorWipe(uint32_t c, uint8_t wait)
+/**************************************************************************/
+/*!
+    @brief  Print how busy the scheduler is every STATS_INTERVAL ms
+*/
+/**************************************************************************/
+void StatsTask(Task &task)
 {
-  pixel_number = 0;
-  last_frame_time = millis();
-  wait_time = wait;
-  color = c;
+  TASK_BEGIN(task);
+  for (;;)
+  {
+    TASK_SLEEP(task, STATS_INTERVAL);
+    Serial.print(F("sched: "));
+    Serial.print(scheduler_stats.dispatches);
+    Serial.print(F(" slices, overhead "));
+    Serial.print(scheduler_stats.overhead_us);
+    Serial.print(F(" us, busy "));
+    Serial.print(scheduler_stats.busy_us);
+    Serial.print(F(" us, max late "));
+    Serial.print(scheduler_stats.max_late_ms);
+    Serial.println(F(" ms"));
+    Serial.print(F("power: awake "));
+    Serial.print(PowerDutyCycle());
+    Serial.print(F(" %, "));
+    Serial.print(PowerWakeupRate());
+    Serial.print(F(" wakeups/s, "));
+    Serial.print(pixel.shows_skipped);
+    Serial.println(F(" unchanged frames skipped"));
+    Serial.print(F("ble: "));
+    Serial.print(parser_stats.packets);
+    Serial.print(F(" packets, "));
+    Serial.print(parser_stats.checksum_errors);
+    Serial.print(F(" bad checksums, "));
+    Serial.print(parser_stats.unknown_types);
+    Serial.print(F(" unknown types, "));
+    Serial.print(parser_stats.resyncs);
+    Serial.print(F(" resyncs, "));
+    Serial.print(parser_stats.timeouts);
+    Serial.println(F(" timeouts"));
+    SchedulerResetStats();
+    PowerResetStats();
+    pixel.shows_skipped = 0;
+  }
+  TASK_END(task);
 }
 
-// returns whether or not the colorwipe is fiished
-bool ProcessColorWipe()
+/**************************************************************************/
+/*!
+    @brief  While this sword is the sync master, send our clock and
+            animation every SYNC_INTERVAL ms for the app to pass on
+*/
+/**************************************************************************/
+void SyncMasterTask(Task &task)
 {
-  if (pixel_number < pixel.numPixels())
+  TASK_BEGIN(task);
+  for (;;)
   {
-    if (millis() - last_frame_time >= wait_time) // if current time is after when the current loop iteration should be over
     {
-      if (millis() - last_frame_time <= 2 * wait_time)
-      {
-        last_frame_time += wait_time;
-      }
-      else
-      {
-        last_frame_time = millis();
-      }
-      pixel.setPixelColor(pixel_number, color);
-      pixel.show();
-      pixel_number++; // now on the next loop iteration
+      uint8_t packet[PACKET_SYNC_LEN];
+      BuildSyncPacket(packet);
+      ble.write(packet, PACKET_SYNC_LEN);
     }
-    return false;
-  }
-  else
-  {
-    return true;
+    TASK_SLEEP(task, SYNC_INTERVAL);
   }
+  TASK_END(task);
 }
 
-// returns whether or not the colorwipe is fiished
-bool ProcessRotateColorWipe()
+/**************************************************************************/
+/*!
+    @brief  Act on a packet from the Bluefruit app
+*/
+/**************************************************************************/
+void HandlePacket()
 {
-  if (pixel_number < pixel.numPixels())
+  // Color
+  if (packetbuffer[1] == 'C')
   {
-    if (millis() - last_frame_time >= wait_time) // if current time is after when the current loop iteration should be over
-    {
-      if (millis() - last_frame_time <= 2 * wait_time)
-      {
-        last_frame_time += wait_time;
-      }
-      else
-      {
-        last_frame_time = millis();
-      }
-      pixel.setPixelColor(0, pixel_number, color);
-      pixel.setPixelColor(1, pixel.numPixels() - pixel_number, color);
-      pixel.show();
-      pixel_number++; // now on the next loop iteration
-    }
-    return false;
+    ShowStaticColor(packetbuffer[2], packetbuffer[3], packetbuffer[4]);
+    Serial.print("RGB #");
+    if (red < 0x10)
+      Serial.print("0");
+    Serial.print(red, HEX);
+    if (green < 0x10)
+      Serial.print("0");
+    Serial.print(green, HEX);
+    if (blue < 0x10)
+      Serial.print("0");
+    Serial.println(blue, HEX);
   }
-  else
+
+  // Sync
+  if (packetbuffer[1] == 'S')
   {
-    return true;
+    HandleSyncPacket(packetbuffer);
   }
-}
-
-// void colorWipe(uint32_t c, uint8_t wait)
-// {
-//   for (uint16_t i = 0; i < pixel.numPixels(); i++)
-//   {
-//     pixel.setPixelColor(i, c);
-//     pixel.show();
-//     delay(wait);
-//   }
-// }
-
-void larsonScanner(uint32_t c, uint8_t wait)
-{
-  int j;
 
-  for (uint16_t i = 0; i < pixel.numPixels() + 5; i++)
+  // Modulation slots and envelopes
+  if (packetbuffer[1] == 'P' || packetbuffer[1] == 'E')
   {
-    // Draw 5 pixels centered on pos.  setPixelColor() will clip any
-    // pixels off the ends of the strip, we don't need to watch for that.
-    pixel.setPixelColor(pos - 2, 0x003b85); // Dark red
-    pixel.setPixelColor(pos - 1, 0x005ed2); // Medium red
-    pixel.setPixelColor(pos, 0x00c0ff);     // Center pixel is brightest
-    pixel.setPixelColor(pos + 1, 0x005ed2); // Medium red
-    pixel.setPixelColor(pos + 2, 0x003b85); // Dark red
-
-    pixel.show();
-    delay(wait);
-
-    // Rather than being sneaky and erasing just the tail pixel,
-    // it's easier to erase it all and draw a new one next time.
-    for (j = -2; j <= 2; j++)
-      pixel.setPixelColor(pos + j, 0);
-
-    // Bounce off ends of strip
-    pos += dir;
-    if (pos < 0)
+    if (!HandleModulationPacket(packetbuffer))
     {
-      pos = 1;
-      dir = -dir;
+      Serial.println(F("Bad modulation packet"));
     }
-    else if (pos >= pixel.numPixels())
+  }
+
+  // Ignition curves and durations
+  if (packetbuffer[1] == 'I')
+  {
+    if (!HandleIgnitionPacket(packetbuffer))
     {
-      pos = pixel.numPixels() - 2;
-      dir = -dir;
+      Serial.println(F("Bad ignition packet"));
     }
   }
-  // colorWipe(pixel.Color(0, 0, 0), 20);
-}
-
-void flashRandom(int wait, uint8_t howmany)
-{
 
-  for (uint16_t i = 0; i < howmany; i++)
+  // Buttons
+  if (packetbuffer[1] == 'B')
   {
-    // get a random pixel from the list
-    int j = random(pixel.numPixels());
 
-    // now we will 'fade' it in 5 steps
-    for (int x = 0; x < 5; x++)
+    uint8_t buttnum = packetbuffer[2] - '0';
+    boolean pressed = packetbuffer[3] - '0';
+    Serial.print("Button ");
+    Serial.print(buttnum);
+    animationState = buttnum;
+    // button 1 is the envelope gate while an envelope is set, else it
+    // ignites / retracts; the gate also closes once the envelope is gone
+    bool gating = animationState == 1 && ModulationHasEnvelope();
+    if (animationState == 1)
     {
-      int r = red * (x + 1);
-      r /= 5;
-      int g = green * (x + 1);
-      g /= 5;
-      int b = blue * (x + 1);
-      b /= 5;
-
-      pixel.setPixelColor(j, pixel.Color(r, g, b));
-      pixel.show();
-      delay(wait);
+      ModulationGate(pressed && gating);
     }
-    // & fade out in 5 steps
-    for (int x = 5; x >= 0; x--)
+    if (pressed)
     {
-      int r = red * x;
-      r /= 5;
-      int g = green * x;
-      g /= 5;
-      int b = blue * x;
-      b /= 5;
-
-      pixel.setPixelColor(j, pixel.Color(r, g, b));
-      pixel.show();
-      delay(wait);
-    }
-  }
-  // LEDs will be off when done (they are faded to 0)
-}
+      Serial.println(" pressed");
 
-void rainbow(uint8_t wait)
-{
-  uint16_t i, j;
+      if (animationState == 1 && !gating) // ignite / retract
+      {
+        ToggleBlade();
+      }
 
-  for (j = 0; j < 256; j++)
-  {
-    for (i = 0; i < pixel.numPixels(); i++)
-    {
-      pixel.setPixelColor(i, Wheel((i + j) & 255));
-    }
-    pixel.show();
-    delay(wait);
-  }
-}
+      /*  if (animationState == 1)
+       {
+         larsonScanner(pixel.Color(255, 255, 255), 20);
+         larsonScanner(pixel.Color(0, 255, 255), 20);
+         larsonScanner(pixel.Color(0, 100, 255), 20);
+         larsonScanner(pixel.Color(0, 50, 255), 20);
+         pixel.show(); // This sends the updated pixel color to the hardware.
+       } */
 
-// Slightly different, this makes the rainbow equally distributed throughout
-void rainbowCycle(uint8_t wait)
-{
-  uint16_t i, j;
+      if (animationState == 2)
+      {
+        StartMode(Mode::ColorWipes);
+      }
 
-  for (j = 0; j < 256 * 5; j++)
-  { // 5 cycles of all colors on wheel
-    for (i = 0; i < pixel.numPixels(); i++)
-    {
-      pixel.setPixelColor(i, Wheel(((i * 256 / pixel.numPixels()) + j) & 255));
-    }
-    pixel.show();
-    delay(wait);
-  }
-}
+      /* if (animationState == 3)
+      {
+        for (uint16_t i = 0; i < pixel.numPixels(); i++)
+        {
+          pixel.setPixelColor(i, pixel.Color(0, 0, 0));
+        }
+        pixel.setBrightness(255);
+        theaterChase(255, 30);
+        theaterChase(255, 40);
+        theaterChase(255, 50);
+        theaterChase(255, 60);
+        theaterChase(255, 70);
+        theaterChase(255, 80);
+        theaterChase(255, 90);
+        theaterChase(255, 100);
+        colorWipe(pixel.Color(0, 0, 255), 20);
+        colorWipe(pixel.Color(0, 0, 0), 20);
+        pixel.show(); // This sends the updated pixel color to the hardware.
+      }
 
-// Theatre-style crawling lights.
-void theaterChase(uint32_t c, uint8_t wait)
-{
-  for (int j = 0; j < 10; j++)
-  { // do 10 cycles of chasing
-    for (int q = 0; q < 3; q++)
-    {
-      for (uint8_t i = 0; i < pixel.numPixels(); i = i + 3)
+      if (animationState == 4)
       {
-        pixel.setPixelColor(i + q, c); // turn every third pixel on
+        for (uint16_t i = 0; i < pixel.numPixels(); i++)
+        {
+          pixel.setPixelColor(i, pixel.Color(0, 0, 0));
+        }
+        pixel.setBrightness(255);
+        rainbowCycle(10);
+        pixel.show(); // This sends the updated pixel color to the hardware.
+      } */
+
+      if (animationState == 3)
+      {
+        StartMode(Mode::AudioReactive);
       }
-      pixel.show();
 
-      delay(wait);
+      if (animationState == 4) // cycle fire -> plasma -> flicker
+      {
+        if (current_mode == Mode::Fire)
+        {
+          StartMode(Mode::Plasma);
+        }
+        else if (current_mode == Mode::Plasma)
+        {
+          StartMode(Mode::Flicker);
+        }
+        else
+        {
+          StartMode(Mode::Fire);
+        }
+      }
 
-      for (uint8_t i = 0; i < pixel.numPixels(); i = i + 3)
+      if (animationState == 6) // pause
       {
-        pixel.setPixelColor(i + q, 0); // turn every third pixel off
+        PauseAnimation();
       }
-    }
-  }
-}
 
-// Theatre-style crawling lights with rainbow effect
-void theaterChaseRainbow(uint8_t wait)
-{
-  for (int j = 0; j < 256; j++)
-  { // cycle all 256 colors in the wheel
-    for (int q = 0; q < 3; q++)
-    {
-      for (uint8_t i = 0; i < pixel.numPixels(); i = i + 3)
+      if (animationState == 5) // resume
       {
-        pixel.setPixelColor(i + q, Wheel((i + j) % 255)); // turn every third pixel on
+        ResumeAnimation();
       }
-      pixel.show();
 
-      delay(wait);
+      if (animationState == 7) // become / stop being the sync master
+      {
+        sync_master = !sync_master;
+        if (sync_master)
+        {
+          // AnimationTime() carries on from the old master's clock if we
+          // were locked to one, so nothing jumps
+          TaskStart(sync_task, SyncMasterTask, nullptr);
+        }
+        else
+        {
+          TaskSuspend(sync_task);
+        }
+        Serial.println(sync_master ? F("Sync master") : F("Sync receiver"));
+      }
 
-      for (uint8_t i = 0; i < pixel.numPixels(); i = i + 3)
+      if (animationState == 8)
       {
-        pixel.setPixelColor(i + q, 0); // turn every third pixel off
+        StartMode(Mode::RotateColorWipes);
       }
     }
+    else
+    {
+      Serial.println(" released");
+    }
   }
 }
-
-// Input a value 0 to 255 to get a color value.
-// The colours are a transition r - g - b - back to r.
-uint32_t Wheel(byte WheelPos)
-{
-  WheelPos = 255 - WheelPos;
-  if (WheelPos < 85)
-  {
-    return pixel.Color(255 - WheelPos * 3, 0, WheelPos * 3);
-  }
-  if (WheelPos < 170)
-  {
-    WheelPos -= 85;
-    return pixel.Color(0, WheelPos * 3, 255 - WheelPos * 3);
-  }
-  WheelPos -= 170;
-  return pixel.Color(WheelPos * 3, 255 - WheelPos * 3, 0);
-}
@@ -0,0 +1,470 @@
+#include <chrono>
+#include <deque>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "../PacketStream.h"
+#include "BleBench.h"
+#include "HostPlatform.h"
+
+/*=========================================================================
+    SIMULATED BLUEFRUIT
+
+    Stand-in for Adafruit_BluefruitLE_SPI in DATA mode: bytes arrive over
+    the air at scheduled times, available() with an empty library FIFO
+    costs one SDEP transaction that moves up to 16 bytes into it, and
+    read() is served from that FIFO.  The transaction cost is a model
+    (command + response at 4MHz SPI plus the module's turnaround), not a
+    measurement.
+    -----------------------------------------------------------------------*/
+class SimBluefruit
+{
+public:
+  static const uint32_t kTransactionUs = 150;
+  static const uint32_t kByteUs = 4;
+  static const uint8_t kSdepPayload = 16;
+
+  void schedule(uint64_t time_us, const uint8_t *data, uint8_t len)
+  {
+    arrivals.push_back(Arrival{time_us, std::vector<uint8_t>(data, data + len)});
+  }
+
+  int available()
+  {
+    if (!fifo.empty())
+    {
+      return fifo.size();
+    }
+    receive();
+    transactions++;
+    uint8_t n = 0;
+    while (!air.empty() && n < kSdepPayload)
+    {
+      fifo.push_back(air.front());
+      air.pop_front();
+      n++;
+    }
+    HostClockAdvance(kTransactionUs + n * kByteUs);
+    return fifo.size();
+  }
+
+  int read()
+  {
+    if (fifo.empty() && available() <= 0)
+    {
+      return -1;
+    }
+    uint8_t c = fifo.front();
+    fifo.pop_front();
+    return c;
+  }
+
+  bool done() const { return arrivals.empty() && air.empty() && fifo.empty(); }
+
+  uint32_t transactions{0};
+
+private:
+  struct Arrival
+  {
+    uint64_t time_us;
+    std::vector<uint8_t> data;
+  };
+
+  // move everything that has arrived by now into the module's UART buffer
+  void receive()
+  {
+    while (!arrivals.empty() && arrivals.front().time_us <= HostClockMicros())
+    {
+      air.insert(air.end(), arrivals.front().data.begin(), arrivals.front().data.end());
+      arrivals.pop_front();
+    }
+  }
+
+  std::deque<Arrival> arrivals;
+  std::deque<uint8_t> air;
+  std::deque<uint8_t> fifo;
+};
+
+// The previous readPacket(), kept here as the baseline
+static uint8_t old_packetbuffer[READ_BUFSIZE + 64];
+
+static uint8_t OldReadPacket(SimBluefruit *ble, uint16_t timeout)
+{
+  uint16_t origtimeout = timeout, replyidx = 0;
+
+  memset(old_packetbuffer, 0, READ_BUFSIZE);
+
+  while (timeout--)
+  {
+    if (replyidx >= 20) break;
+    if ((old_packetbuffer[1] == 'B') && (replyidx == PACKET_BUTTON_LEN))
+      break;
+    if ((old_packetbuffer[1] == 'C') && (replyidx == PACKET_COLOR_LEN))
+      break;
+
+    while (ble->available())
+    {
+      char c = ble->read();
+      if (c == '!')
+      {
+        replyidx = 0;
+      }
+      // the original has no bound here; clamp so the bench cannot overrun
+      if (replyidx < sizeof(old_packetbuffer) - 1)
+      {
+        old_packetbuffer[replyidx] = c;
+        replyidx++;
+      }
+      timeout = origtimeout;
+    }
+
+    if (timeout == 0) break;
+    delay(1);
+  }
+
+  old_packetbuffer[replyidx] = 0;
+  if (!replyidx || old_packetbuffer[0] != '!')
+    return 0;
+
+  uint8_t xsum = 0;
+  for (uint8_t i = 0; i < replyidx - 1; i++)
+    xsum += old_packetbuffer[i];
+  if ((uint8_t)~xsum != old_packetbuffer[replyidx - 1])
+    return 0;
+  return replyidx;
+}
+
+// Button and color packets, alternating, with valid checksums.  The old
+// parser restarts on any '!', so payloads whose bytes or checksum would
+// contain one are nudged to keep every packet receivable by both.
+static std::vector<std::vector<uint8_t>> MakePackets(uint32_t count)
+{
+  std::vector<std::vector<uint8_t>> packets;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    std::vector<uint8_t> p;
+    uint8_t xsum;
+    for (uint8_t nudge = 0;; nudge++)
+    {
+      if (i & 1)
+      {
+        p = {'!', 'C', (uint8_t)(i + nudge), (uint8_t)(i >> 8), 0x40};
+      }
+      else
+      {
+        p = {'!', 'B', (uint8_t)('1' + i % 8), (uint8_t)('0' + nudge % 2)};
+      }
+      xsum = 0;
+      bool clean = true;
+      for (size_t k = 0; k < p.size(); k++)
+      {
+        xsum += p[k];
+        clean = clean && (k == 0 || p[k] != '!');
+      }
+      if (clean && (uint8_t)~xsum != '!')
+      {
+        break;
+      }
+    }
+    p.push_back(~xsum);
+    packets.push_back(p);
+  }
+  return packets;
+}
+
+struct BleResult
+{
+  uint32_t packets;
+  uint32_t bytes;
+  uint32_t transactions;
+  uint64_t ble_us; // simulated time spent inside the receive path
+  double host_ns;
+};
+
+static void Schedule(SimBluefruit &sim, const std::vector<std::vector<uint8_t>> &packets, uint32_t gap_us)
+{
+  for (size_t i = 0; i < packets.size(); i++)
+  {
+    sim.schedule((uint64_t)i * gap_us, packets[i].data(), packets[i].size());
+  }
+}
+
+// old loop(): readPacket() every pass, 1ms of rendering in between
+static BleResult RunOld(const std::vector<std::vector<uint8_t>> &packets, uint32_t gap_us)
+{
+  SimBluefruit sim;
+  Schedule(sim, packets, gap_us);
+  HostClockReset();
+  BleResult r{};
+  auto start = std::chrono::steady_clock::now();
+  while (!sim.done())
+  {
+    uint64_t t0 = HostClockMicros();
+    uint8_t len = OldReadPacket(&sim, 10);
+    r.ble_us += HostClockMicros() - t0;
+    if (len)
+    {
+      r.packets++;
+      r.bytes += len;
+    }
+    HostClockAdvance(1000);
+  }
+  r.host_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  r.transactions = sim.transactions;
+  return r;
+}
+
+// BleTask: every 5ms drain the module into the ring and parse what is there
+static BleResult RunNew(const std::vector<std::vector<uint8_t>> &packets, uint32_t gap_us)
+{
+  SimBluefruit sim;
+  Schedule(sim, packets, gap_us);
+  HostClockReset();
+  ResetPacketParser();
+  RxRing ring{};
+  BleResult r{};
+  auto start = std::chrono::steady_clock::now();
+  while (!sim.done() || RxCount(ring))
+  {
+    uint64_t t0 = HostClockMicros();
+    bool filled = false;
+    if (!RxCount(ring))
+    {
+      RxFill(ring, sim);
+      filled = true;
+    }
+    for (;;)
+    {
+      uint8_t len = ParsePacket(ring, 10);
+      if (len)
+      {
+        r.packets++;
+        r.bytes += len;
+        continue;
+      }
+      if (!RxCount(ring))
+      {
+        if (filled)
+          break;
+        RxFill(ring, sim);
+        filled = true;
+      }
+    }
+    r.ble_us += HostClockMicros() - t0;
+    HostClockAdvance(5000);
+  }
+  r.host_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  r.transactions = sim.transactions;
+  return r;
+}
+
+static void Print(const char *name, uint32_t sent, const BleResult &r)
+{
+  printf("  %-4s %6u/%-6u packets %8u transactions %8.2f bytes/ms %8.1f us/packet %8.0f host ns/packet\n",
+         name, (unsigned)r.packets, (unsigned)sent, (unsigned)r.transactions,
+         r.ble_us ? r.bytes * 1000.0 / r.ble_us : 0.0,
+         r.packets ? (double)r.ble_us / r.packets : 0.0,
+         r.packets ? r.host_ns / r.packets : 0.0);
+}
+
+void RunBleBench(uint32_t count)
+{
+  std::vector<std::vector<uint8_t>> packets = MakePackets(count);
+  const uint32_t gaps_us[] = {20000, 7500, 1000, 0};
+  for (uint32_t gap : gaps_us)
+  {
+    printf("one packet every %u us:\n", (unsigned)gap);
+    Print("old", count, RunOld(packets, gap));
+    Print("new", count, RunNew(packets, gap));
+  }
+}
+
+/*=========================================================================
+    PARSER FUZZ
+
+    Packets of every type with random payloads (binary ones may contain
+    '!', and so may checksums) go through ParsePacket() in random chunks
+    of up to one SDEP payload, after a seeded corruption pass:
+      - a byte dropped, a bit flipped or the tail cut off a packet, each
+        with probability rate
+      - 1..8 random bytes inserted between packets, with probability rate
+      - now and then a pause long enough for the partial packet timeout
+    A packet that comes out must be one that was sent, in order; an
+    untouched packet that does not come out was lost to the corruption
+    around it.  test/test_parser checks the results with fixed seeds.
+    -----------------------------------------------------------------------*/
+static uint32_t fuzz_seed;
+
+static uint32_t FuzzRandom()
+{
+  fuzz_seed ^= fuzz_seed << 13;
+  fuzz_seed ^= fuzz_seed >> 17;
+  fuzz_seed ^= fuzz_seed << 5;
+  return fuzz_seed;
+}
+
+// true with probability per_mille / 1000
+static bool FuzzChance(uint32_t per_mille)
+{
+  return FuzzRandom() % 1000 < per_mille;
+}
+
+static std::vector<uint8_t> MakeFuzzPacket()
+{
+  static const struct
+  {
+    uint8_t type;
+    uint8_t len;
+    bool hex;
+  } kinds[] = {
+      {'A', PACKET_ACC_LEN, false}, {'G', PACKET_GYRO_LEN, false}, {'M', PACKET_MAG_LEN, false},
+      {'Q', PACKET_QUAT_LEN, false}, {'B', PACKET_BUTTON_LEN, false}, {'C', PACKET_COLOR_LEN, false},
+      {'L', PACKET_LOCATION_LEN, false}, {'S', PACKET_SYNC_LEN, true}, {'P', PACKET_MODPARAM_LEN, true},
+      {'E', PACKET_ENVELOPE_LEN, true}, {'I', PACKET_IGNITION_LEN, true},
+  };
+  const auto &k = kinds[FuzzRandom() % (sizeof(kinds) / sizeof(kinds[0]))];
+  std::vector<uint8_t> p{'!', k.type};
+  uint8_t xsum = '!' + k.type;
+  for (uint8_t i = 2; i < k.len - 1; i++)
+  {
+    uint8_t c;
+    if (k.type == 'B')
+      c = i == 2 ? '1' + FuzzRandom() % 8 : '0' + FuzzRandom() % 2;
+    else if (k.hex)
+      c = "0123456789ABCDEF"[FuzzRandom() % 16];
+    else
+      c = FuzzRandom();
+    p.push_back(c);
+    xsum += c;
+  }
+  p.push_back(~xsum);
+  return p;
+}
+
+FuzzResult RunFuzz(uint32_t count, uint32_t rate, uint32_t seed)
+{
+  fuzz_seed = seed;
+  std::vector<std::vector<uint8_t>> sent;
+  std::vector<bool> intact;
+  std::vector<uint8_t> stream;
+  std::vector<size_t> pauses; // stream offsets after which the sender goes quiet
+  for (uint32_t i = 0; i < count; i++)
+  {
+    if (FuzzChance(rate))
+    {
+      for (uint32_t n = 1 + FuzzRandom() % 8; n; n--)
+      {
+        stream.push_back(FuzzRandom());
+      }
+    }
+    std::vector<uint8_t> p = MakeFuzzPacket();
+    std::vector<uint8_t> wire = p;
+    bool ok = true;
+    if (FuzzChance(rate))
+    {
+      wire.erase(wire.begin() + FuzzRandom() % wire.size());
+      ok = false;
+    }
+    if (FuzzChance(rate))
+    {
+      wire[FuzzRandom() % wire.size()] ^= 1 << (FuzzRandom() % 8);
+      ok = false;
+    }
+    if (FuzzChance(rate))
+    {
+      wire.resize(FuzzRandom() % wire.size());
+      ok = false;
+    }
+    sent.push_back(p);
+    intact.push_back(ok);
+    stream.insert(stream.end(), wire.begin(), wire.end());
+    if (FuzzChance(rate / 4 + 1))
+    {
+      pauses.push_back(stream.size());
+    }
+  }
+
+  HostClockReset();
+  ResetPacketParser();
+  parser_stats = ParserStats{};
+  RxRing ring{};
+  FuzzResult r{};
+  r.sent = count;
+  r.bytes = stream.size();
+  for (bool ok : intact)
+  {
+    r.intact += ok;
+  }
+  std::vector<bool> seen(count, false);
+  size_t next = 0; // packets come out in order, nothing before this can match any more
+  size_t pos = 0;
+  size_t pause = 0;
+  auto start = std::chrono::steady_clock::now();
+  while (pos < stream.size() || RxCount(ring))
+  {
+    size_t chunk = 1 + FuzzRandom() % SimBluefruit::kSdepPayload;
+    size_t end = pause < pauses.size() ? pauses[pause] : stream.size();
+    while (chunk-- && pos < end && RxFree(ring))
+    {
+      RxPush(ring, stream[pos++]);
+    }
+    while (uint8_t len = ParsePacket(ring, 10))
+    {
+      uint8_t xsum = 0;
+      for (uint8_t b = 0; b < len - 1; b++)
+      {
+        xsum += packetbuffer[b];
+      }
+      if ((uint8_t)~xsum != packetbuffer[len - 1])
+      {
+        r.bad_checksums++;
+      }
+      size_t i = next;
+      while (i < sent.size() && (sent[i].size() != len || memcmp(sent[i].data(), packetbuffer, len) != 0))
+      {
+        i++;
+      }
+      if (i == sent.size())
+      {
+        r.bogus++;
+        continue;
+      }
+      seen[i] = true;
+      next = i + 1;
+    }
+    HostClockAdvance(1000);
+    if (pause < pauses.size() && pos == pauses[pause] && !RxCount(ring))
+    {
+      pause++;
+      HostClockAdvance(20000);
+      ParsePacket(ring, 10);
+    }
+  }
+  // the last partial packet
+  HostClockAdvance(20000);
+  ParsePacket(ring, 10);
+  r.host_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  for (uint32_t i = 0; i < count; i++)
+  {
+    r.recovered += seen[i] && intact[i];
+  }
+  r.stats = parser_stats;
+  return r;
+}
+
+void RunParserFuzz(uint32_t count)
+{
+  printf("%8s %8s %10s %7s %8s %8s %8s %8s %8s %10s\n", "corrupt", "intact", "recovered", "bogus", "badsum",
+         "unknown", "resyncs", "timeouts", "noise", "ns/byte");
+  const uint32_t rates[] = {0, 10, 50, 200};
+  for (uint32_t rate : rates)
+  {
+    FuzzResult r = RunFuzz(count, rate, 0x2545F491 + rate);
+    printf("%7.1f%% %8u %9.2f%% %7u %8u %8u %8u %8u %8u %10.2f\n", rate / 10.0, (unsigned)r.intact,
+           r.intact ? 100.0 * r.recovered / r.intact : 0.0, (unsigned)r.bogus, (unsigned)r.stats.checksum_errors,
+           (unsigned)r.stats.unknown_types, (unsigned)r.stats.resyncs, (unsigned)r.stats.timeouts,
+           (unsigned)r.stats.noise_bytes, r.bytes ? r.host_ns / r.bytes : 0.0);
+  }
+  printf("(the counters are 16 bits and wrap on long runs)\n");
+}
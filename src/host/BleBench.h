@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+#include "../PacketStream.h"
+
+// Compare the old blocking readPacket() with RxFill/ParsePacket on a simulated Bluefruit
+void RunBleBench(uint32_t packets);
+
+struct FuzzResult
+{
+  uint32_t sent;
+  uint32_t intact;        // sent without corruption
+  uint32_t recovered;     // intact packets that came out
+  uint32_t bogus;         // packets that came out but were never sent, passed on a checksum collision
+  uint32_t bad_checksums; // packets that came out with a wrong checksum
+  uint32_t bytes;
+  double host_ns;
+  ParserStats stats;
+};
+
+// Send count random packets through ParsePacket(), each corrupted with
+// probability rate / 1000, and match what comes out against what was
+// sent; the same seed gives the same stream
+FuzzResult RunFuzz(uint32_t count, uint32_t rate, uint32_t seed);
+
+// Feed ParsePacket() a stream of every packet type with dropped, flipped
+// and inserted bytes, check what comes out and time it
+void RunParserFuzz(uint32_t packets);
@@ -0,0 +1,118 @@
+#include <string.h>
+#include "FrameSinkOutput.h"
+#include "HostPlatform.h"
+#include "../Dither.h"
+
+static void WriteLE(FILE *out, uint32_t value, uint8_t bytes)
+{
+  for (uint8_t i = 0; i < bytes; i++)
+  {
+    fputc((value >> (8 * i)) & 0xff, out);
+  }
+}
+
+void FrameSinkOutput::begin()
+{
+  for (uint8_t s = 0; s < kStrips; s++)
+  {
+    for (uint16_t i = 0; i < NUMPIXELS; i++)
+    {
+      colors[s][i] = 0;
+    }
+  }
+  brightness = 255;
+  frames_shown = 0;
+  shows_skipped = 0;
+  dirty = true;
+  between = false;
+  memset(residue, 0, sizeof(residue));
+}
+
+void FrameSinkOutput::setPixelColor(uint16_t n, uint32_t c)
+{
+  // out of range writes are ignored, like Adafruit_NeoPixel
+  if (n < NUMPIXELS && (colors[0][n] != c || colors[1][n] != c))
+  {
+    colors[0][n] = c;
+    colors[1][n] = c;
+    dirty = true;
+  }
+}
+
+void FrameSinkOutput::setPixelColor(bool strip, uint16_t n, uint32_t c)
+{
+  if (n < NUMPIXELS && colors[strip ? 1 : 0][n] != c)
+  {
+    colors[strip ? 1 : 0][n] = c;
+    dirty = true;
+  }
+}
+
+void FrameSinkOutput::setBrightness(uint8_t b)
+{
+  brightness = b;
+  dirty = true;
+}
+
+void FrameSinkOutput::show()
+{
+  if (!dirty && !between)
+  {
+    shows_skipped++;
+    return;
+  }
+  dirty = false;
+
+  // same scaling as Adafruit_NeoPixel: 255 passes colors through unchanged
+  uint16_t scale = (uint16_t)brightness + 1;
+#if DITHER
+  between = false;
+  for (uint8_t s = 0; s < kStrips; s++)
+  {
+    uint8_t full[NUMPIXELS][3];
+    for (uint16_t i = 0; i < NUMPIXELS; i++)
+    {
+      uint32_t c = colors[s][i];
+      full[i][0] = c >> 16;
+      full[i][1] = c >> 8;
+      full[i][2] = c;
+    }
+    between = DitherScale(&shown[s][0][0], &full[0][0], &residue[s][0][0], NUMPIXELS * 3, scale) || between;
+  }
+  if (between)
+  {
+    DitherWake();
+  }
+#else
+  for (uint8_t s = 0; s < kStrips; s++)
+  {
+    for (uint16_t i = 0; i < NUMPIXELS; i++)
+    {
+      uint32_t c = colors[s][i];
+      shown[s][i][0] = (((c >> 16) & 0xff) * scale) >> 8;
+      shown[s][i][1] = (((c >> 8) & 0xff) * scale) >> 8;
+      shown[s][i][2] = ((c & 0xff) * scale) >> 8;
+    }
+  }
+#endif
+  frames_shown++;
+
+  if (listener)
+  {
+    listener->onFrame(&shown[0][0][0], HostClockMicros());
+  }
+  if (!out)
+  {
+    return;
+  }
+  if (!header_written)
+  {
+    fputs("BLDF", out);
+    fputc(1, out);
+    fputc(kStrips, out);
+    WriteLE(out, NUMPIXELS, 2);
+    header_written = true;
+  }
+  WriteLE(out, (uint32_t)HostClockMicros(), 4);
+  fwrite(shown, sizeof(shown), 1, out);
+}
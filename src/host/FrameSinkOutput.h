@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdio.h>
+#include "../OutputDriver.h"
+#include "../BladeConfig.h"
+
+/*=========================================================================
+    FRAME SINK OUTPUT
+
+    Host OutputDriver that streams every show() as a raw frame to a file or
+    pipe instead of to NeoPixels.  Like DualNeopixel, a show() with nothing
+    changed since the last one is skipped and produces no frame, and with
+    DITHER the brightness is applied through DitherScale().
+
+    Stream format (all integers little endian):
+      header  'B' 'L' 'D' 'F', uint8 version (1), uint8 strips (2),
+              uint16 pixels per strip
+      frame   uint32 timestamp in us of the simulated clock, then
+              strips * pixels * 3 bytes of R, G, B with brightness applied
+    -----------------------------------------------------------------------*/
+class FrameListener
+{
+public:
+  // frame is strips * pixels * 3 bytes of R, G, B, time_us is the simulated clock
+  virtual void onFrame(const uint8_t *frame, uint64_t time_us) = 0;
+
+protected:
+  ~FrameListener() = default;
+};
+
+class FrameSinkOutput : public OutputDriver
+{
+public:
+  static const uint8_t kStrips = 2;
+  static const uint32_t kFrameBytes = kStrips * NUMPIXELS * 3;
+
+  // out may be nullptr to render without writing anything (throughput runs)
+  explicit FrameSinkOutput(FILE *out = nullptr) : out{out} {}
+
+  void setOutput(FILE *file) { out = file; }
+  void setListener(FrameListener *l) { listener = l; }
+
+  void begin();
+  void setPixelColor(uint16_t n, uint32_t c);
+  void setPixelColor(bool strip, uint16_t n, uint32_t c);
+  void show();
+  void setBrightness(uint8_t b);
+  uint16_t numPixels() const { return NUMPIXELS; }
+  bool dithering() const { return between; }
+
+  // the last frame passed to show(), brightness applied
+  const uint8_t *lastFrame() const { return &shown[0][0][0]; }
+  uint32_t framesShown() const { return frames_shown; }
+  uint32_t showsSkipped() const { return shows_skipped; }
+
+private:
+  FILE *out;
+  FrameListener *listener{nullptr};
+  bool header_written{false};
+  uint8_t brightness{255};
+  uint32_t frames_shown{0};
+  uint32_t shows_skipped{0};
+  bool dirty{true};
+  bool between{false}; // the last show() left channels between levels
+  uint32_t colors[kStrips][NUMPIXELS]{};
+  uint8_t shown[kStrips][NUMPIXELS][3]{};
+  uint8_t residue[kStrips][NUMPIXELS][3]{};
+};
@@ -0,0 +1,78 @@
+#include "../Platform.h"
+#include "HostPlatform.h"
+
+static uint64_t clock_us{0};
+static int32_t skew_ppm{0};
+static uint64_t skew_offset_us{0};
+static uint32_t random_state{1};
+
+void HostClockReset()
+{
+  clock_us = 0;
+  skew_ppm = 0;
+  skew_offset_us = 0;
+}
+
+void HostClockAdvance(uint32_t us)
+{
+  clock_us += us;
+}
+
+uint64_t HostClockMicros()
+{
+  return clock_us;
+}
+
+void HostClockSkew(int32_t ppm, uint64_t offset_us)
+{
+  skew_ppm = ppm;
+  skew_offset_us = offset_us;
+}
+
+// what this board's own clock reads
+static uint64_t LocalMicros()
+{
+  return skew_offset_us + clock_us + (int64_t)clock_us * skew_ppm / 1000000;
+}
+
+unsigned long millis()
+{
+  return (unsigned long)(LocalMicros() / 1000);
+}
+
+unsigned long micros()
+{
+  return (unsigned long)LocalMicros();
+}
+
+void delay(unsigned long ms)
+{
+  clock_us += (uint64_t)ms * 1000;
+}
+
+void HostRandomSeed(uint32_t seed)
+{
+  random_state = seed ? seed : 1;
+}
+
+// xorshift32, so the sequence is the same on every host
+long random(long howbig)
+{
+  if (howbig <= 0)
+  {
+    return 0;
+  }
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return (long)(random_state % (uint32_t)howbig);
+}
+
+long random(long howsmall, long howbig)
+{
+  if (howsmall >= howbig)
+  {
+    return howsmall;
+  }
+  return howsmall + random(howbig - howsmall);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+/*=========================================================================
+    HOST PLATFORM
+
+    Simulated clock behind millis()/micros()/delay() for host builds.  Time
+    only moves when delay() or HostClockAdvance() is called, so a run is
+    deterministic and as fast as the host can render it.
+    -----------------------------------------------------------------------*/
+void HostClockReset();
+void HostClockAdvance(uint32_t us);
+// The true simulated time, unaffected by HostClockSkew()
+uint64_t HostClockMicros();
+
+// Let millis()/micros() run ppm fast (or slow, if negative) against the true
+// clock and start offset_us ahead of it, like the crystal of another board.
+// HostClockReset() clears the skew.
+void HostClockSkew(int32_t ppm, uint64_t offset_us);
+
+// Reseed random() so runs can be reproduced exactly
+void HostRandomSeed(uint32_t seed);
@@ -0,0 +1,167 @@
+#include <chrono>
+#include <stdio.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "../Dither.h"
+#include "../Effects.h"
+#include "../Ignition.h"
+#include "../Modulation.h"
+#include "../NoiseEffects.h"
+#include "../Scheduler.h"
+#include "HostPlatform.h"
+#include "KernelBench.h"
+
+static uint64_t Cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static uint16_t bench_t{0};
+
+static void BenchWheel()
+{
+  for (uint16_t i = 0; i < NUMPIXELS; i++)
+  {
+    pixel.setPixelColor(i, Wheel(i + bench_t));
+  }
+}
+static void BenchNoise8()
+{
+  for (uint16_t i = 0; i < NUMPIXELS; i++)
+  {
+    pixel.setPixelColor(i, Noise8(i << 6, bench_t));
+  }
+}
+static void BenchFire() { RenderFire(); }
+static void BenchPlasma() { RenderPlasma(bench_t); }
+static void BenchFlicker() { RenderFlicker(bench_t); }
+// both strips through the dither stage at a low brightness
+static void BenchDither()
+{
+  static uint8_t in[NUMPIXELS * 3];
+  static uint8_t out[NUMPIXELS * 3];
+  static uint8_t residue[2][NUMPIXELS * 3];
+  in[bench_t % sizeof(in)] = bench_t;
+  DitherScale(out, in, residue[0], sizeof(in), 25);
+  DitherScale(out, in, residue[1], sizeof(in), 25);
+}
+static void BenchIgnition() { RenderBladeLength(EaseAt(Ease::Overshoot, bench_t << 4)); }
+
+struct Kernel
+{
+  const char *name;
+  void (*render)();
+  uint8_t strips; // strips one call computes separately (1: both sides share the colors)
+};
+
+static const Kernel kernels[] = {
+    {"wheel", BenchWheel, 1},
+    {"noise8", BenchNoise8, 1},
+    {"fire", BenchFire, 2},
+    {"plasma", BenchPlasma, 2},
+    {"flicker", BenchFlicker, 2},
+    {"ignition", BenchIgnition, 1},
+    {"dither", BenchDither, 2},
+};
+
+// A task that does nothing but sleep, so only the scheduler is measured
+struct IdleState
+{
+  uint8_t period;
+};
+
+static void IdleTask(Task &task)
+{
+  IdleState &s = *static_cast<IdleState *>(task.state);
+  TASK_BEGIN(task);
+  for (;;)
+  {
+    TASK_SLEEP(task, s.period);
+  }
+  TASK_END(task);
+}
+
+// Eight tasks with periods of 1..8 ms, one SchedulerRun() per simulated ms
+static void RunSchedulerBench(uint32_t ms)
+{
+  static Task tasks[8];
+  static IdleState states[8];
+  HostClockReset();
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    states[i].period = i + 1;
+    TaskStart(tasks[i], IdleTask, &states[i]);
+  }
+  SchedulerResetStats();
+
+  uint64_t c0 = Cycles();
+  for (uint32_t t = 0; t < ms; t++)
+  {
+    SchedulerRun();
+    HostClockAdvance(1000);
+  }
+  uint64_t cycles = Cycles() - c0;
+
+  double slices = scheduler_stats.dispatches;
+  // micros() is the simulated clock here, so overhead_us is meaningless; count cycles instead
+  printf("\nscheduler: %.0f slices, %.1f cycles/slice including the run loop\n",
+         slices, slices > 0 ? cycles / slices : 0.0);
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    TaskSuspend(tasks[i]);
+  }
+}
+
+// ModulationUpdate() with every slot busy, one of each kind of source
+static void RunModulationBench(uint32_t frames)
+{
+  HostClockReset();
+  ModulationBind(0, ModShape::Sine, ModTarget::Brightness, 40, 255, 1500);
+  ModulationBind(1, ModShape::Triangle, ModTarget::Hue, 0, 255, 4000);
+  ModulationBind(2, ModShape::Saw, ModTarget::Speed, 64, 192, 2500);
+  ModulationBind(3, ModShape::Envelope, ModTarget::FireCooling, 20, 100, 0);
+  ModulationGate(true);
+
+  uint64_t c0 = Cycles();
+  for (uint32_t f = 0; f < frames; f++)
+  {
+    ModulationUpdate();
+    HostClockAdvance(MOD_FRAME_MS * 1000);
+  }
+  uint64_t cycles = Cycles() - c0;
+  printf("modulation: %.1f cycles/slot including the clock\n", (double)cycles / frames / MOD_SLOTS);
+  ModulationReset();
+}
+
+void RunKernelBench(uint32_t frames)
+{
+  // rdtsc cycles of this host CPU, a relative cost only: AVR counts come from the avrbench target
+  printf("%-8s %12s %10s %14s\n", "kernel", "host cyc/px", "ns/px", "max frames/s");
+  StartNoiseEffect();
+  for (const Kernel &k : kernels)
+  {
+    bench_t = 0;
+    auto start = std::chrono::steady_clock::now();
+    uint64_t c0 = Cycles();
+    for (uint32_t f = 0; f < frames; f++)
+    {
+      k.render();
+      bench_t += 3;
+    }
+    uint64_t cycles = Cycles() - c0;
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    double px = (double)frames * k.strips * NUMPIXELS;
+    // frames/s the kernel alone could hold on this host for both strips of NUMPIXELS
+    double frame_ns = ns / frames;
+    printf("%-8s %12.1f %10.2f %14.0f\n", k.name, cycles / px, ns / px, frame_ns > 0 ? 1e9 / frame_ns : 0.0);
+  }
+  RunSchedulerBench(frames);
+  RunModulationBench(frames);
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <stdint.h>
+
+// Time every effect kernel over `frames` frames and print cycles and ns per pixel,
+// then the scheduler's cost per task slice
+void RunKernelBench(uint32_t frames);
@@ -0,0 +1,32 @@
+#include <string.h>
+#include "StripImageWriter.h"
+
+StripImageWriter::StripImageWriter(uint32_t fps, uint32_t duration_ms)
+    : fps{fps}, num_rows{(uint32_t)((uint64_t)duration_ms * fps / 1000)}
+{
+  image.reserve((size_t)num_rows * FrameSinkOutput::kFrameBytes);
+}
+
+void StripImageWriter::fillUntil(uint64_t time_us)
+{
+  // row r samples the blade at r / fps seconds
+  while (rows_done < num_rows && (uint64_t)rows_done * 1000000 / fps < time_us)
+  {
+    image.insert(image.end(), current, current + sizeof(current));
+    rows_done++;
+  }
+}
+
+void StripImageWriter::onFrame(const uint8_t *frame, uint64_t time_us)
+{
+  // a frame shown exactly on a sample instant belongs to that row
+  fillUntil(time_us);
+  memcpy(current, frame, sizeof(current));
+}
+
+bool StripImageWriter::write(FILE *out)
+{
+  finish();
+  fprintf(out, "P6\n%u %u\n255\n", (unsigned)(FrameSinkOutput::kStrips * NUMPIXELS), (unsigned)num_rows);
+  return fwrite(image.data(), 1, image.size(), out) == image.size();
+}
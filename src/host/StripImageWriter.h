@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+#include "FrameSinkOutput.h"
+
+/*=========================================================================
+    STRIP IMAGE WRITER
+
+    Turns a run of an effect into a time-by-pixel image: one row per frame
+    at a fixed frame rate, both strips side by side (first strip on the
+    left).  Each row shows whatever was last passed to show() at that
+    instant, so the image changes when either the colors or the timing of
+    an effect change.  Written as binary PPM (P6).
+    -----------------------------------------------------------------------*/
+class StripImageWriter : public FrameListener
+{
+public:
+  StripImageWriter(uint32_t fps, uint32_t duration_ms);
+
+  void onFrame(const uint8_t *frame, uint64_t time_us) override;
+
+  // Hold the last frame until the end of the run and write the image
+  bool write(FILE *out);
+
+  // Hold the last frame until the end of the run, then row() may be read
+  void finish() { fillUntil(UINT64_MAX); }
+  const uint8_t *row(uint32_t r) const { return &image[(size_t)r * FrameSinkOutput::kFrameBytes]; }
+
+  uint32_t rows() const { return num_rows; }
+
+private:
+  // append rows for every sample instant before time_us
+  void fillUntil(uint64_t time_us);
+
+  uint32_t fps;
+  uint32_t num_rows;
+  uint32_t rows_done{0};
+  uint8_t current[FrameSinkOutput::kFrameBytes]{};
+  std::vector<uint8_t> image;
+};
@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "../Animation.h"
+#include "../Effects.h"
+#include "../Ignition.h"
+#include "../PacketStream.h"
+#include "../Scheduler.h"
+#include "../Sync.h"
+#include "FrameSinkOutput.h"
+#include "HostPlatform.h"
+#include "StripImageWriter.h"
+#include "SyncSim.h"
+
+/*=========================================================================
+    SYNC SIMULATION
+
+    The swords of a run share globals, so they are simulated one after the
+    other against the same true clock: first the master, recording its
+    sync packets, then every receiver with its own crystal error, clock
+    offset and mode, getting those packets after a random link delay.
+    Each run is sampled at kFps, and once a receiver has had kLockMs to
+    lock its rows are compared with the master's.
+    -----------------------------------------------------------------------*/
+static const uint32_t kFps = 100;
+static const uint32_t kLockMs = 3000;
+static const uint32_t kMasterStartMs = 250;
+
+struct SyncPacket
+{
+  uint64_t time_us; // true time the master wrote it
+  uint8_t data[PACKET_SYNC_LEN];
+};
+
+struct Receiver
+{
+  const char *name;
+  int32_t ppm;
+  uint32_t offset_ms;
+  Mode mode; // what it shows before the first sync packet
+  uint32_t min_delay_ms, max_delay_ms;
+};
+
+static const Receiver receivers[] = {
+    {"fast", 500, 3600000, Mode::Fire, 10, 25},
+    {"slow", -500, 12345, Mode::ColorWipes, 10, 25},
+    {"jittery", 100, 777, Mode::Static, 5, 45},
+};
+
+static void StartSword(FrameSinkOutput &sink, StripImageWriter *image)
+{
+  sink.setOutput(nullptr);
+  sink.setListener(image);
+  HostClockReset();
+  HostRandomSeed(1);
+  ResetEffectState();
+  ResetPacketParser();
+  SyncReset();
+  sync_master = false;
+  sink.begin();
+  StartMode(Mode::Static);
+}
+
+// What the master does after starting its mode
+enum class MasterScript : uint8_t
+{
+  Run,
+  Pause,      // paused for the middle fifth of the run
+  PauseMotion // retracts at 2/5 of the run and is paused halfway through it until 3/5
+};
+
+static void RunMaster(FrameSinkOutput &sink, Mode mode, MasterScript script, uint32_t duration_ms,
+                      StripImageWriter *image, std::vector<SyncPacket> *packets)
+{
+  StartSword(sink, image);
+  sync_master = true;
+  uint32_t next_sync = kMasterStartMs;
+  uint32_t pause_ms = duration_ms * 2 / 5;
+  if (script == MasterScript::PauseMotion)
+  {
+    pause_ms += RETRACTION_MS / 2;
+  }
+  while (millis() < duration_ms)
+  {
+    if (millis() == kMasterStartMs)
+    {
+      StartMode(mode);
+    }
+    if (script == MasterScript::PauseMotion && millis() == duration_ms * 2 / 5)
+    {
+      ToggleBlade();
+    }
+    if (script != MasterScript::Run && millis() == pause_ms)
+    {
+      PauseAnimation();
+    }
+    if (script != MasterScript::Run && millis() == duration_ms * 3 / 5)
+    {
+      ResumeAnimation();
+    }
+    SchedulerRun();
+    if (millis() >= next_sync)
+    {
+      // what SyncMasterTask does on the sword
+      SyncPacket p;
+      p.time_us = HostClockMicros();
+      BuildSyncPacket(p.data);
+      packets->push_back(p);
+      next_sync += SYNC_INTERVAL;
+    }
+    HostClockAdvance(1000);
+  }
+  image->finish();
+}
+
+struct PhaseError
+{
+  uint32_t worst;
+  double mean;
+};
+
+// |AnimationTime() - true time| once the receiver had kLockMs to lock
+static PhaseError RunReceiver(FrameSinkOutput &sink, const Receiver &r, uint32_t duration_ms,
+                              StripImageWriter *image, const std::vector<SyncPacket> &packets)
+{
+  StartSword(sink, image);
+  HostClockSkew(r.ppm, (uint64_t)r.offset_ms * 1000);
+  StartMode(r.mode);
+
+  // arrival times of every packet over a jittery link
+  std::vector<uint64_t> arrival;
+  for (const SyncPacket &p : packets)
+  {
+    arrival.push_back(p.time_us + (r.min_delay_ms + random(r.max_delay_ms - r.min_delay_ms + 1)) * 1000);
+  }
+
+  RxRing ring{};
+  size_t next = 0;
+  PhaseError phase{0, 0.0};
+  uint32_t samples = 0;
+  while (HostClockMicros() < (uint64_t)duration_ms * 1000)
+  {
+    for (; next < packets.size() && arrival[next] <= HostClockMicros(); next++)
+    {
+      for (uint8_t i = 0; i < PACKET_SYNC_LEN; i++)
+      {
+        RxPush(ring, packets[next].data[i]);
+      }
+    }
+    // what BleTask and HandlePacket do on the sword
+    uint8_t len;
+    while ((len = ParsePacket(ring, 100)) != 0)
+    {
+      if (packetbuffer[1] == 'S')
+      {
+        HandleSyncPacket(packetbuffer);
+      }
+    }
+    SchedulerRun();
+
+    if (HostClockMicros() >= (uint64_t)kLockMs * 1000)
+    {
+      int32_t error = (int32_t)(AnimationTime() - (uint32_t)(HostClockMicros() / 1000));
+      uint32_t e = error < 0 ? -error : error;
+      phase.worst = e > phase.worst ? e : phase.worst;
+      phase.mean += e;
+      samples++;
+    }
+    HostClockAdvance(1000);
+  }
+  image->finish();
+  phase.mean = samples ? phase.mean / samples : 0.0;
+  return phase;
+}
+
+static void SimulateMode(FrameSinkOutput &sink, const char *name, Mode mode, uint32_t duration_ms,
+                         MasterScript script = MasterScript::Run)
+{
+  std::vector<SyncPacket> packets;
+  StripImageWriter master{kFps, duration_ms};
+  RunMaster(sink, mode, script, duration_ms, &master, &packets);
+  bool pause = script == MasterScript::Pause;
+  bool motion = script == MasterScript::PauseMotion;
+
+  uint32_t first_row = kLockMs * kFps / 1000;
+  for (const Receiver &r : receivers)
+  {
+    StripImageWriter image{kFps, duration_ms};
+    PhaseError phase = RunReceiver(sink, r, duration_ms, &image, packets);
+
+    uint32_t same = 0;
+    uint32_t paused_same = 0;
+    uint32_t paused_rows = 0;
+    // receivers do not follow a retraction, so while the master is paused
+    // in one they keep the lit blade they showed before it started
+    const uint8_t *lit = image.row(master.rows() * 2 / 5 - 1);
+    for (uint32_t row = first_row; row < master.rows(); row++)
+    {
+      bool identical = memcmp(image.row(row), master.row(row), FrameSinkOutput::kFrameBytes) == 0;
+      same += identical;
+      if ((pause || motion) && row >= master.rows() * 2 / 5 && row < master.rows() * 3 / 5)
+      {
+        paused_same += motion ? memcmp(image.row(row), lit, FrameSinkOutput::kFrameBytes) == 0 : identical;
+        paused_rows++;
+      }
+    }
+    fprintf(stderr, "%-16s %-8s %+5d ppm, link %2u-%2u ms: drift %+5.0f ppm, error mean %4.1f max %2u ms, "
+                    "%u/%u rows identical",
+            name, r.name, (int)r.ppm, (unsigned)r.min_delay_ms, (unsigned)r.max_delay_ms,
+            SyncDrift() * 1e6 / (1 << 20), phase.mean, (unsigned)phase.worst, (unsigned)same,
+            (unsigned)(master.rows() - first_row));
+    if (pause)
+    {
+      fprintf(stderr, ", %u/%u while paused", (unsigned)paused_same, (unsigned)paused_rows);
+    }
+    if (motion)
+    {
+      fprintf(stderr, ", %u/%u still lit while paused retracting", (unsigned)paused_same, (unsigned)paused_rows);
+    }
+    fprintf(stderr, "\n");
+  }
+}
+
+void RunSyncSim(FrameSinkOutput &sink, uint32_t duration_ms)
+{
+  SimulateMode(sink, "colorwipes", Mode::ColorWipes, duration_ms);
+  SimulateMode(sink, "rotatecolorwipes", Mode::RotateColorWipes, duration_ms);
+  SimulateMode(sink, "plasma", Mode::Plasma, duration_ms);
+  SimulateMode(sink, "flicker", Mode::Flicker, duration_ms);
+  SimulateMode(sink, "plasma paused", Mode::Plasma, duration_ms, MasterScript::Pause);
+  SimulateMode(sink, "wipes paused", Mode::ColorWipes, duration_ms, MasterScript::Pause);
+  SimulateMode(sink, "retract paused", Mode::Ignition, duration_ms, MasterScript::PauseMotion);
+}
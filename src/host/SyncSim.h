@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdint.h>
+
+class FrameSinkOutput;
+
+// Run a sync master and several drifting receivers and compare what they show
+void RunSyncSim(FrameSinkOutput &sink, uint32_t duration_ms);
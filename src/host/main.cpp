@@ -0,0 +1,445 @@
+/*********************************************************************
+ Host driver for the blade effects.
+
+ Runs the same scheduler tasks the sword runs from loop(), or one of
+ the blocking effects, on a simulated clock and captures every frame
+ through FrameSinkOutput.
+
+   blade_host <mode|all> <duration_ms> [options]
+   blade_host bench [frames]
+   blade_host blebench [packets]
+   blade_host parserfuzz [packets]
+   blade_host syncsim [duration_ms]
+
+   --raw <file|->    stream raw timestamped frames (see FrameSinkOutput.h)
+   --ppm <file>      write a time-by-pixel image (see StripImageWriter.h)
+   --ppm-dir <dir>   with "all": write <dir>/<mode>.ppm for every mode,
+                     creating <dir> if needed
+   --fps <n>         image rows per second (default 100)
+   --pcm <file>      microphone input for "audio": signed 16 bit little
+                     endian mono at AUDIO_SAMPLE_RATE, silence if omitted
+   --mod <shape>:<target>:<low>:<high>:<period_ms>
+                     modulate a parameter (see Modulation.h), up to
+                     MOD_SLOTS times; shape is sine, triangle, saw, square
+                     or envelope, target brightness, speed, hue, cooling
+                     or sparking
+   --env <attack_ms>:<decay_ms>:<sustain>:<release_ms>
+                     envelope of the --mod slots with shape envelope; the
+                     gate is held for the first half of the run
+   --ignition <curve>:<ignition_ms>:<retraction_ms>
+                     easing curve and durations of "ignition" and
+                     "retraction"; curve is linear, inout, overshoot or
+                     flicker (see Ignition.h)
+
+ "bench" times the effect kernels and the scheduler without any output,
+ "blebench" the BLE receive path against a simulated Bluefruit module,
+ "parserfuzz" the packet parser on a corrupted stream,
+ "syncsim" how closely drifting swords follow a sync master.
+
+ Without an output the frames are rendered but not written, which
+ measures pure effect throughput.
+*********************************************************************/
+
+#include <chrono>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+#include "../Animation.h"
+#include "../AudioReactive.h"
+#include "../Effects.h"
+#include "../Ignition.h"
+#include "../Modulation.h"
+#include "../Scheduler.h"
+#include "FrameSinkOutput.h"
+#include "HostPlatform.h"
+#include "BleBench.h"
+#include "KernelBench.h"
+#include "StripImageWriter.h"
+#include "SyncSim.h"
+
+BladeOutput pixel;
+
+// the unit tests under test/ link the host code with their own main()
+#ifndef PIO_UNIT_TESTING
+
+static FrameSinkOutput &sink = pixel;
+
+static void RunLarsonScanner() { larsonScanner(OutputDriver::Color(0, 192, 255), 20); }
+static void RunFlashRandom() { flashRandom(10, 10); }
+static void RunRainbow() { rainbow(20); }
+static void RunRainbowCycle() { rainbowCycle(10); }
+static void RunTheaterChase() { theaterChase(OutputDriver::Color(0, 0, 255), 50); }
+static void RunTheaterChaseRainbow() { theaterChaseRainbow(50); }
+
+// A mode is either one of the loop() driven Modes or a blocking effect,
+// which is simply called again until the run is over
+struct HostMode
+{
+  const char *name;
+  Mode mode;
+  void (*blocking)();
+};
+
+static const HostMode host_modes[] = {
+    {"static", Mode::Static, nullptr},
+    {"colorwipes", Mode::ColorWipes, nullptr},
+    {"rotatecolorwipes", Mode::RotateColorWipes, nullptr},
+    {"audio", Mode::AudioReactive, nullptr},
+    {"fire", Mode::Fire, nullptr},
+    {"plasma", Mode::Plasma, nullptr},
+    {"flicker", Mode::Flicker, nullptr},
+    {"ignition", Mode::Ignition, nullptr},
+    {"retraction", Mode::Retraction, nullptr},
+    {"larsonscanner", Mode::Static, RunLarsonScanner},
+    {"flashrandom", Mode::Static, RunFlashRandom},
+    {"rainbow", Mode::Static, RunRainbow},
+    {"rainbowcycle", Mode::Static, RunRainbowCycle},
+    {"theaterchase", Mode::Static, RunTheaterChase},
+    {"theaterchaserainbow", Mode::Static, RunTheaterChaseRainbow},
+};
+
+struct ModBinding
+{
+  ModShape shape;
+  ModTarget target;
+  uint8_t low;
+  uint8_t high;
+  uint16_t period_ms;
+};
+
+static const char *const shape_names[] = {"off", "sine", "triangle", "saw", "square", "envelope"};
+static const char *const target_names[] = {"brightness", "speed", "hue", "cooling", "sparking"};
+static const char *const ease_names[] = {"linear", "inout", "overshoot", "flicker"};
+
+static int FindName(const char *name, size_t len, const char *const *names, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    if (strlen(names[i]) == len && strncmp(name, names[i], len) == 0)
+    {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+// <shape>:<target>:<low>:<high>:<period_ms>
+static bool ParseModulation(const char *arg, ModBinding *mod)
+{
+  const char *colon = strchr(arg, ':');
+  if (!colon)
+  {
+    return false;
+  }
+  int shape = FindName(arg, colon - arg, shape_names, sizeof(shape_names) / sizeof(shape_names[0]));
+  const char *target_name = colon + 1;
+  colon = strchr(target_name, ':');
+  if (shape < 0 || !colon)
+  {
+    return false;
+  }
+  int target = FindName(target_name, colon - target_name, target_names, sizeof(target_names) / sizeof(target_names[0]));
+  unsigned low, high, period;
+  if (target < 0 || sscanf(colon + 1, "%u:%u:%u", &low, &high, &period) != 3 || low > 255 || high > 255 ||
+      period > 0xffff)
+  {
+    return false;
+  }
+  *mod = ModBinding{(ModShape)shape, (ModTarget)target, (uint8_t)low, (uint8_t)high, (uint16_t)period};
+  return true;
+}
+
+// <curve>:<ignition_ms>:<retraction_ms>
+static bool ParseIgnition(const char *arg, Ease *curve, unsigned *ignition_ms, unsigned *retraction_ms)
+{
+  const char *colon = strchr(arg, ':');
+  if (!colon)
+  {
+    return false;
+  }
+  int c = FindName(arg, colon - arg, ease_names, sizeof(ease_names) / sizeof(ease_names[0]));
+  if (c < 0 || sscanf(colon + 1, "%u:%u", ignition_ms, retraction_ms) != 2 || *ignition_ms > 0xffff ||
+      *retraction_ms > 0xffff)
+  {
+    return false;
+  }
+  *curve = (Ease)c;
+  return true;
+}
+
+struct Options
+{
+  uint32_t duration_ms{0};
+  uint32_t fps{100};
+  const char *raw{nullptr};
+  const char *ppm{nullptr};
+  const char *ppm_dir{nullptr};
+  std::vector<int16_t> pcm;
+  std::vector<ModBinding> mods;
+  unsigned env[4]{100, 200, 192, 500};
+  Ease ease{Ease::Overshoot};
+  Ease retract_ease{Ease::InOut};
+  unsigned ignition_ms{IGNITION_MS};
+  unsigned retraction_ms{RETRACTION_MS};
+};
+
+static bool LoadPcm(const char *path, std::vector<int16_t> *pcm)
+{
+  FILE *f = fopen(path, "rb");
+  if (!f)
+  {
+    perror(path);
+    return false;
+  }
+  uint8_t b[2];
+  while (fread(b, 1, 2, f) == 2)
+  {
+    pcm->push_back((int16_t)(b[0] | (b[1] << 8)));
+  }
+  fclose(f);
+  return true;
+}
+
+// Push the PCM samples that the ADC would have delivered by now, as 10-bit readings
+static void FeedMicrophone(const std::vector<int16_t> &pcm, uint64_t *fed)
+{
+  uint64_t due = HostClockMicros() * AUDIO_SAMPLE_RATE / 1000000;
+  for (; *fed < due; (*fed)++)
+  {
+    int16_t s = *fed < pcm.size() ? pcm[*fed] : 0;
+    AudioPushSample((uint16_t)((s >> 6) + 512));
+  }
+}
+
+static void Usage()
+{
+  fprintf(stderr, "usage: blade_host <mode|all> <duration_ms> [--raw file|-] [--ppm file] "
+                  "[--ppm-dir dir] [--fps n] [--pcm file]\n"
+                  "           [--mod shape:target:low:high:period_ms] [--env attack:decay:sustain:release]\n"
+                  "           [--ignition curve:ignition_ms:retraction_ms]\n"
+                  "       blade_host bench [frames]\n"
+                  "       blade_host blebench [packets]\n"
+                  "       blade_host parserfuzz [packets]\n"
+                  "       blade_host syncsim [duration_ms]\nmodes:");
+  for (const HostMode &m : host_modes)
+  {
+    fprintf(stderr, " %s", m.name);
+  }
+  fprintf(stderr, "\n");
+}
+
+static FILE *OpenOutput(const char *path)
+{
+  FILE *f = strcmp(path, "-") == 0 ? stdout : fopen(path, "wb");
+  if (!f)
+  {
+    perror(path);
+  }
+  return f;
+}
+
+static void CloseOutput(FILE *f)
+{
+  if (f && f != stdout)
+  {
+    fclose(f);
+  }
+}
+
+static bool RunMode(const HostMode &m, const Options &opt, const char *ppm_path)
+{
+  FILE *raw = nullptr;
+  if (opt.raw && !(raw = OpenOutput(opt.raw)))
+  {
+    return false;
+  }
+  StripImageWriter image{opt.fps, opt.duration_ms};
+
+  sink.setOutput(raw);
+  sink.setListener(ppm_path ? &image : nullptr);
+  HostClockReset();
+  HostRandomSeed(1);
+  ResetEffectState();
+  pixel.begin();
+  IgnitionConfigure(opt.ease, opt.ignition_ms, opt.retract_ease, opt.retraction_ms);
+  StartMode(Mode::Static);
+  StartMode(m.mode);
+  ModulationReset();
+  for (size_t i = 0; i < opt.mods.size(); i++)
+  {
+    const ModBinding &b = opt.mods[i];
+    ModulationEnvelope(i, opt.env[0], opt.env[1], opt.env[2], opt.env[3]);
+    ModulationBind(i, b.shape, b.target, b.low, b.high, b.period_ms);
+  }
+  ModulationGate(!opt.mods.empty());
+
+  uint64_t samples_fed = 0;
+  uint32_t wakeups = 0; // loop() passes that ran a task, the rest would sleep on the sword
+  auto start = std::chrono::steady_clock::now();
+  while (millis() < opt.duration_ms)
+  {
+    if (m.blocking)
+    {
+      m.blocking();
+    }
+    else
+    {
+      // one loop() iteration per simulated millisecond
+      FeedMicrophone(opt.pcm, &samples_fed);
+      if (millis() >= opt.duration_ms / 2)
+      {
+        ModulationGate(false);
+      }
+      wakeups += SchedulerRun() != 0;
+      HostClockAdvance(1000);
+    }
+  }
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  CloseOutput(raw);
+
+  bool ok = true;
+  if (ppm_path)
+  {
+    FILE *f = OpenOutput(ppm_path);
+    ok = f && image.write(f);
+    CloseOutput(f);
+  }
+  // blocking effects run to completion, so the simulated time can overshoot
+  fprintf(stderr, "%s: %u frames (%u unchanged skipped), %.0f wakeups/s in %lu ms simulated, "
+                  "%.3f ms wall, %.0f frames/s\n",
+          m.name, (unsigned)sink.framesShown(), (unsigned)sink.showsSkipped(),
+          millis() ? wakeups * 1000.0 / millis() : 0.0, millis(), wall_s * 1e3,
+          wall_s > 0 ? sink.framesShown() / wall_s : 0.0);
+  return ok;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc >= 2 && strcmp(argv[1], "bench") == 0)
+  {
+    RunKernelBench(argc > 2 ? strtoul(argv[2], nullptr, 10) : 100000);
+    return 0;
+  }
+  if (argc >= 2 && strcmp(argv[1], "blebench") == 0)
+  {
+    RunBleBench(argc > 2 ? strtoul(argv[2], nullptr, 10) : 2000);
+    return 0;
+  }
+  if (argc >= 2 && strcmp(argv[1], "parserfuzz") == 0)
+  {
+    RunParserFuzz(argc > 2 ? strtoul(argv[2], nullptr, 10) : 20000);
+    return 0;
+  }
+  if (argc >= 2 && strcmp(argv[1], "syncsim") == 0)
+  {
+    RunSyncSim(sink, argc > 2 ? strtoul(argv[2], nullptr, 10) : 30000);
+    return 0;
+  }
+  if (argc < 3)
+  {
+    Usage();
+    return 1;
+  }
+  Options opt;
+  opt.duration_ms = strtoul(argv[2], nullptr, 10);
+  for (int i = 3; i < argc; i++)
+  {
+    if (i + 1 >= argc)
+    {
+      Usage();
+      return 1;
+    }
+    if (strcmp(argv[i], "--raw") == 0)
+      opt.raw = argv[++i];
+    else if (strcmp(argv[i], "--ppm") == 0)
+      opt.ppm = argv[++i];
+    else if (strcmp(argv[i], "--ppm-dir") == 0)
+      opt.ppm_dir = argv[++i];
+    else if (strcmp(argv[i], "--fps") == 0)
+      opt.fps = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "--mod") == 0)
+    {
+      ModBinding mod;
+      if (opt.mods.size() >= MOD_SLOTS || !ParseModulation(argv[++i], &mod))
+      {
+        Usage();
+        return 1;
+      }
+      opt.mods.push_back(mod);
+    }
+    else if (strcmp(argv[i], "--env") == 0)
+    {
+      unsigned *e = opt.env;
+      if (sscanf(argv[++i], "%u:%u:%u:%u", &e[0], &e[1], &e[2], &e[3]) != 4 || e[2] > 255)
+      {
+        Usage();
+        return 1;
+      }
+    }
+    else if (strcmp(argv[i], "--ignition") == 0)
+    {
+      if (!ParseIgnition(argv[++i], &opt.ease, &opt.ignition_ms, &opt.retraction_ms))
+      {
+        Usage();
+        return 1;
+      }
+      opt.retract_ease = opt.ease;
+    }
+    else if (strcmp(argv[i], "--pcm") == 0)
+    {
+      if (!LoadPcm(argv[++i], &opt.pcm))
+        return 1;
+    }
+    else
+    {
+      Usage();
+      return 1;
+    }
+  }
+  if (opt.fps == 0)
+  {
+    Usage();
+    return 1;
+  }
+
+  if (opt.ppm_dir && mkdir(opt.ppm_dir, 0777) != 0 && errno != EEXIST)
+  {
+    perror(opt.ppm_dir);
+    return 1;
+  }
+
+  bool all = strcmp(argv[1], "all") == 0;
+  bool ok = true;
+  bool found = false;
+  for (const HostMode &m : host_modes)
+  {
+    if (!all && strcmp(argv[1], m.name) != 0)
+    {
+      continue;
+    }
+    found = true;
+    std::string path;
+    if (opt.ppm_dir)
+    {
+      path = std::string(opt.ppm_dir) + "/" + m.name + ".ppm";
+    }
+    else if (opt.ppm)
+    {
+      path = opt.ppm;
+    }
+    ok = RunMode(m, opt, path.empty() ? nullptr : path.c_str()) && ok;
+  }
+  if (!found)
+  {
+    Usage();
+    return 1;
+  }
+  return ok ? 0 : 1;
+}
+
+#endif // PIO_UNIT_TESTING
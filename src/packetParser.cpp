@@ -10,20 +10,10 @@
 #include "Adafruit_BluefruitLE_UART.h"
 
 
-#define PACKET_ACC_LEN                  (15)
-#define PACKET_GYRO_LEN                 (15)
-#define PACKET_MAG_LEN                  (15)
-#define PACKET_QUAT_LEN                 (19)
-#define PACKET_BUTTON_LEN               (5)
-#define PACKET_COLOR_LEN                (6)
-#define PACKET_LOCATION_LEN             (15)
+#include "PacketStream.h"
 
-//    READ_BUFSIZE            Size of the read buffer for incoming packets
-#define READ_BUFSIZE                    (20)
-
-
-/* Buffer to hold incoming characters */
-uint8_t packetbuffer[READ_BUFSIZE+1];
+/* Bytes pulled from the module but not parsed yet */
+static RxRing rx_ring;
 
 /**************************************************************************/
 /*!
@@ -70,71 +60,34 @@ void printHex(const uint8_t * data, const uint32_t numBytes)
 
 /**************************************************************************/
 /*!
-    @brief  Waits for incoming data and parses it
+    @brief  Returns the next complete packet without waiting for one
+
+    Call until it returns 0.  The module is only read once the bytes left
+    over from earlier calls are used up, and then in bulk (see RxFill).
+    timeout is how long a partly received packet may wait for the rest.
 */
 /**************************************************************************/
 uint8_t readPacket(Adafruit_BLE *ble, uint16_t timeout) 
 {
-  uint16_t origtimeout = timeout, replyidx = 0;
-
-  memset(packetbuffer, 0, READ_BUFSIZE);
-
-  while (timeout--) {
-    if (replyidx >= 20) break;
-    if ((packetbuffer[1] == 'A') && (replyidx == PACKET_ACC_LEN))
-      break;
-    if ((packetbuffer[1] == 'G') && (replyidx == PACKET_GYRO_LEN))
-      break;
-    if ((packetbuffer[1] == 'M') && (replyidx == PACKET_MAG_LEN))
-      break;
-    if ((packetbuffer[1] == 'Q') && (replyidx == PACKET_QUAT_LEN))
-      break;
-    if ((packetbuffer[1] == 'B') && (replyidx == PACKET_BUTTON_LEN))
-      break;
-    if ((packetbuffer[1] == 'C') && (replyidx == PACKET_COLOR_LEN))
-      break;
-    if ((packetbuffer[1] == 'L') && (replyidx == PACKET_LOCATION_LEN))
-      break;
-
-    while (ble->available()) {
-      char c =  ble->read();
-      if (c == '!') {
-        replyidx = 0;
-      }
-      packetbuffer[replyidx] = c;
-      replyidx++;
-      timeout = origtimeout;
-    }
-    
-    if (timeout == 0) break;
-    delay(1);
-  }
-
-  packetbuffer[replyidx] = 0;  // null term
+  bool filled = false;
 
-  if (!replyidx)  // no data or timeout 
-    return 0;
-  if (packetbuffer[0] != '!')  // doesn't start with '!' packet beginning
-    return 0;
-  
-  // check checksum!
-  uint8_t xsum = 0;
-  uint8_t checksum = packetbuffer[replyidx-1];
-  
-  for (uint8_t i=0; i<replyidx-1; i++) {
-    xsum += packetbuffer[i];
+  if (!RxCount(rx_ring)) {
+    RxFill(rx_ring, *ble);
+    filled = true;
   }
-  xsum = ~xsum;
 
-  // Throw an error message if the checksum's don't match
-  if (xsum != checksum)
-  {
-    Serial.print("Checksum mismatch in packet : ");
-    printHex(packetbuffer, replyidx+1);
-    return 0;
+  for (;;) {
+    uint8_t len = ParsePacket(rx_ring, timeout);
+    if (len)
+      return len;
+
+    // bad packets are only counted (parser_stats), printing each one
+    // would hold up the next while the radio is noisy
+    if (!RxCount(rx_ring)) {
+      if (filled)
+        return 0;
+      RxFill(rx_ring, *ble);
+      filled = true;
+    }
   }
-  
-  // checksum passed!
-  return replyidx;
 }
-
@@ -0,0 +1,56 @@
+/*********************************************************************
+ Unit tests of the BLE packet parser (PacketStream.h).
+
+   pio test -e native
+
+ Runs the "parserfuzz" stream of src/host/BleBench.cpp with fixed
+ seeds, so every run sees the same packets and the same corruption.
+*********************************************************************/
+
+#include <unity.h>
+
+#include "host/BleBench.h"
+
+static const uint32_t kPackets = 5000;
+static const uint32_t kSeed = 0x2545F491;
+
+void setUp() {}
+void tearDown() {}
+
+static void CheckRecovery(uint32_t rate, double floor_percent)
+{
+  FuzzResult r = RunFuzz(kPackets, rate, kSeed + rate);
+  TEST_ASSERT_EQUAL_UINT32(kPackets, r.sent);
+  TEST_ASSERT_EQUAL_UINT32(0, r.bad_checksums);
+  TEST_ASSERT_TRUE(r.intact > 0);
+  TEST_ASSERT_TRUE(100.0 * r.recovered / r.intact >= floor_percent);
+}
+
+// a clean stream: every packet, in order, and nothing else
+static void test_clean_stream()
+{
+  FuzzResult r = RunFuzz(kPackets, 0, kSeed);
+  TEST_ASSERT_EQUAL_UINT32(kPackets, r.intact);
+  TEST_ASSERT_EQUAL_UINT32(kPackets, r.recovered);
+  TEST_ASSERT_EQUAL_UINT32(0, r.bogus);
+  TEST_ASSERT_EQUAL_UINT32(0, r.bad_checksums);
+  TEST_ASSERT_EQUAL_UINT16(0, r.stats.checksum_errors);
+  TEST_ASSERT_EQUAL_UINT16(0, r.stats.noise_bytes);
+  TEST_ASSERT_EQUAL_UINT16(0, r.stats.timeouts);
+}
+
+// rates are per mille; an intact packet is only lost to the corruption
+// right before it, so recovery stays close to 100%
+static void test_corrupt_1_percent() { CheckRecovery(10, 99.9); }
+static void test_corrupt_5_percent() { CheckRecovery(50, 99.5); }
+static void test_corrupt_20_percent() { CheckRecovery(200, 99.0); }
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_clean_stream);
+  RUN_TEST(test_corrupt_1_percent);
+  RUN_TEST(test_corrupt_5_percent);
+  RUN_TEST(test_corrupt_20_percent);
+  return UNITY_END();
+}